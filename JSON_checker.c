@@ -1,6 +1,6 @@
 /* JSON_checker.c */
 
-/* 2016-11-11 */
+/* 2026-10-17 */
 
 /*
 Copyright (c) 2005 JSON.org
@@ -26,16 +26,31 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "JSON_checker.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_CHECKER_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define UNLIKELY(x) __builtin_expect((x), 0)
+#else
+#define UNLIKELY(x) (x)
+#endif
+
 #define TRUE  1
 #define FALSE 0
 #define GOOD 0xBABAB00E
 #define __   -1     /* the universal error code */
+#define NO_MEMORY -2    /* the character given to fail when memory runs out */
 
 /*
-    Characters are mapped into these 31 character classes. This allows for
+    Characters are mapped into these 32 character classes. This allows for
     a significant reduction in the size of the state transition table.
 */
 
@@ -71,19 +86,21 @@ enum classes {
     C_ABCDF,  /* ABCDF */
     C_E,      /* E */
     C_ETC,    /* everything else */
+    C_CTRL,   /* non-whitespace control characters */
     NR_CLASSES
 };
 
-static int ascii_class[128] = {
+static const uint8_t byte_class[256] = {
 /*
-    This array maps the 128 ASCII characters into character classes.
-    The remaining Unicode characters should be mapped to C_ETC.
-    Non-whitespace control characters are errors.
+    This array maps each of the 256 byte values into a character class.
+    Bytes 128 through 255 are the parts of UTF-8 multibyte sequences, and
+    are mapped to C_ETC. Non-whitespace control characters are mapped to
+    C_CTRL, which is an error in every state.
 */
-    __,      __,      __,      __,      __,      __,      __,      __,
-    __,      C_WHITE, C_WHITE, __,      __,      C_WHITE, __,      __,
-    __,      __,      __,      __,      __,      __,      __,      __,
-    __,      __,      __,      __,      __,      __,      __,      __,
+    C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,
+    C_CTRL,  C_WHITE, C_WHITE, C_CTRL,  C_CTRL,  C_WHITE, C_CTRL,  C_CTRL,
+    C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,
+    C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,  C_CTRL,
 
     C_SPACE, C_ETC,   C_QUOTE, C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
     C_ETC,   C_ETC,   C_ETC,   C_PLUS,  C_COMMA, C_MINUS, C_POINT, C_SLASH,
@@ -98,7 +115,27 @@ static int ascii_class[128] = {
     C_ETC,   C_LOW_A, C_LOW_B, C_LOW_C, C_LOW_D, C_LOW_E, C_LOW_F, C_ETC,
     C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_LOW_L, C_ETC,   C_LOW_N, C_ETC,
     C_ETC,   C_ETC,   C_LOW_R, C_LOW_S, C_LOW_T, C_LOW_U, C_ETC,   C_ETC,
-    C_ETC,   C_ETC,   C_ETC,   C_LCURB, C_ETC,   C_RCURB, C_ETC,   C_ETC
+    C_ETC,   C_ETC,   C_ETC,   C_LCURB, C_ETC,   C_RCURB, C_ETC,   C_ETC,
+
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,
+    C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC,   C_ETC
 };
 
 
@@ -141,46 +178,48 @@ enum states {
 };
 
 
-static int state_transition_table[NR_STATES][NR_CLASSES] = {
+static const uint8_t state_transition_table[NR_STATES][NR_CLASSES] = {
 /*
     The state transition table takes the current state and the current symbol,
     and returns either a new state or an action. An action is represented as a
-    negative number. A JSON text is accepted if at the end of the text the
-    state is OK and if the mode is MODE_DONE.
-
-                 white                                      1-9                                   ABCDF  etc
-             space |  {  }  [  ]  :  ,  "  \  /  +  -  .  0  |  a  b  c  d  e  f  l  n  r  s  t  u  |  E  |*/
-/*start  GO*/ {GO,GO,-6,__,-5,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*ok     OK*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*object OB*/ {OB,OB,__,-9,__,__,__,__,ST,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*key    KE*/ {KE,KE,__,__,__,__,__,__,ST,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*colon  CO*/ {CO,CO,__,__,__,__,-2,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*value  VA*/ {VA,VA,-6,__,-5,__,__,__,ST,__,__,__,MI,__,ZE,IN,__,__,__,__,__,F1,__,N1,__,__,T1,__,__,__,__},
-/*array  AR*/ {AR,AR,-6,__,-5,-7,__,__,ST,__,__,__,MI,__,ZE,IN,__,__,__,__,__,F1,__,N1,__,__,T1,__,__,__,__},
-/*string ST*/ {ST,__,ST,ST,ST,ST,ST,ST,-4,ES,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST},
-/*escape ES*/ {__,__,__,__,__,__,__,__,ST,ST,ST,__,__,__,__,__,__,ST,__,__,__,ST,__,ST,ST,__,ST,U1,__,__,__},
-/*u1     U1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,U2,U2,U2,U2,U2,U2,U2,U2,__,__,__,__,__,__,U2,U2,__},
-/*u2     U2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,U3,U3,U3,U3,U3,U3,U3,U3,__,__,__,__,__,__,U3,U3,__},
-/*u3     U3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,U4,U4,U4,U4,U4,U4,U4,U4,__,__,__,__,__,__,U4,U4,__},
-/*u4     U4*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,ST,ST,ST,ST,ST,ST,ST,ST,__,__,__,__,__,__,ST,ST,__},
-/*minus  MI*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,ZE,IN,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*zero   ZE*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,FR,__,__,__,__,__,__,E1,__,__,__,__,__,__,__,__,E1,__},
-/*int    IN*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,FR,IN,IN,__,__,__,__,E1,__,__,__,__,__,__,__,__,E1,__},
-/*frac   FR*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,FS,FS,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*fracs  FS*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,__,FS,FS,__,__,__,__,E1,__,__,__,__,__,__,__,__,E1,__},
-/*e      E1*/ {__,__,__,__,__,__,__,__,__,__,__,E2,E2,__,E3,E3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*ex     E2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,E3,E3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*exp    E3*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,__,E3,E3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*tr     T1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,T2,__,__,__,__,__,__},
-/*tru    T2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,T3,__,__,__},
-/*true   T3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,OK,__,__,__,__,__,__,__,__,__,__},
-/*fa     F1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,F2,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
-/*fal    F2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,F3,__,__,__,__,__,__,__,__},
-/*fals   F3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,F4,__,__,__,__,__},
-/*false  F4*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,OK,__,__,__,__,__,__,__,__,__,__},
-/*nu     N1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,N2,__,__,__},
-/*nul    N2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,N3,__,__,__,__,__,__,__,__},
-/*null   N3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,OK,__,__,__,__,__,__,__,__}
+    negative number. The table is stored as bytes, so an action is held as 256
+    plus its number, which makes every action larger than every state. A JSON
+    text is accepted if at the end of the text the state is OK and if the mode
+    is MODE_DONE.
+
+                 white                                      1-9                                   ABCDF  etc ctrl
+             space |  {  }  [  ]  :  ,  "  \  /  +  -  .  0  |  a  b  c  d  e  f  l  n  r  s  t  u  |  E  |  |*/
+/*start  GO*/ {GO,GO,-6,__,-5,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*ok     OK*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*object OB*/ {OB,OB,__,-9,__,__,__,__,ST,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*key    KE*/ {KE,KE,__,__,__,__,__,__,ST,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*colon  CO*/ {CO,CO,__,__,__,__,-2,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*value  VA*/ {VA,VA,-6,__,-5,__,__,__,ST,__,__,__,MI,__,ZE,IN,__,__,__,__,__,F1,__,N1,__,__,T1,__,__,__,__,__},
+/*array  AR*/ {AR,AR,-6,__,-5,-7,__,__,ST,__,__,__,MI,__,ZE,IN,__,__,__,__,__,F1,__,N1,__,__,T1,__,__,__,__,__},
+/*string ST*/ {ST,__,ST,ST,ST,ST,ST,ST,-4,ES,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,__},
+/*escape ES*/ {__,__,__,__,__,__,__,__,ST,ST,ST,__,__,__,__,__,__,ST,__,__,__,ST,__,ST,ST,__,ST,U1,__,__,__,__},
+/*u1     U1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,U2,U2,U2,U2,U2,U2,U2,U2,__,__,__,__,__,__,U2,U2,__,__},
+/*u2     U2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,U3,U3,U3,U3,U3,U3,U3,U3,__,__,__,__,__,__,U3,U3,__,__},
+/*u3     U3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,U4,U4,U4,U4,U4,U4,U4,U4,__,__,__,__,__,__,U4,U4,__,__},
+/*u4     U4*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,ST,ST,ST,ST,ST,ST,ST,ST,__,__,__,__,__,__,ST,ST,__,__},
+/*minus  MI*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,ZE,IN,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*zero   ZE*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,FR,__,__,__,__,__,__,E1,__,__,__,__,__,__,__,__,E1,__,__},
+/*int    IN*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,FR,IN,IN,__,__,__,__,E1,__,__,__,__,__,__,__,__,E1,__,__},
+/*frac   FR*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,FS,FS,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*fracs  FS*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,__,FS,FS,__,__,__,__,E1,__,__,__,__,__,__,__,__,E1,__,__},
+/*e      E1*/ {__,__,__,__,__,__,__,__,__,__,__,E2,E2,__,E3,E3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*ex     E2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,E3,E3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*exp    E3*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,__,E3,E3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*tr     T1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,T2,__,__,__,__,__,__,__},
+/*tru    T2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,T3,__,__,__,__},
+/*true   T3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,OK,__,__,__,__,__,__,__,__,__,__,__},
+/*fa     F1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,F2,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*fal    F2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,F3,__,__,__,__,__,__,__,__,__},
+/*fals   F3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,F4,__,__,__,__,__,__},
+/*false  F4*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,OK,__,__,__,__,__,__,__,__,__,__,__},
+/*nu     N1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,N2,__,__,__,__},
+/*nul    N2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,N3,__,__,__,__,__,__,__,__,__},
+/*null   N3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,OK,__,__,__,__,__,__,__,__,__}
 };
 
 
@@ -194,228 +233,4090 @@ enum modes {
     MODE_OBJECT
 };
 
-static void
-destroy(JSON_checker jc)
-{
+
 /*
-    Delete the JSON_checker object.
+    The encodings that a text can be given in. jc->encoding is ENCODING_NONE
+    until the first call that names or detects one.
 */
-    jc->valid = 0;
-    free((void*)jc->stack);
-    free((void*)jc);
-}
+enum encodings {
+    ENCODING_NONE,
+    ENCODING_UTF8,
+    ENCODING_UTF16LE,
+    ENCODING_UTF16BE,
+    ENCODING_UTF32LE,
+    ENCODING_UTF32BE
+};
 
 
-static int
-reject(JSON_checker jc)
-{
 /*
-    Delete the JSON_checker object.
+    Scanning kernels.
+
+    Most of the bytes of a typical JSON text are either inside of strings or
+    are whitespace between tokens. Neither changes the state, so the bulk
+    entry point lets these kernels skip over them many bytes at a time.
+
+    scan_string returns a pointer to the first quote, backslash, or control
+    character, or end if there is none. If high is ~0 rather than 0, it also
+    stops at the first byte of a UTF-8 multibyte sequence.
+
+    skip_white returns a pointer to the first byte that is not a space, tab,
+    linefeed, or carriage return, or end if there is none.
+
+    structure_block finds the quotes, backslashes, and brackets in a block of
+    64 bytes, as masks with one bit per byte. It is used to pass over a
+    subtree without checking it. A square bracket ORed with 0x20 is a curly
+    brace, so one compare finds both kinds of opening bracket, and another
+    both kinds of closing bracket.
+
+    compact writes the bytes of a block of 64 whose bits are set in keep, in
+    order, and returns the end of what it wrote. It may store up to 16 bytes
+    beyond that, so the output must have room to spare. It is used to minify.
+    The SSSE3 version moves 8 bytes at a time into place with a shuffle whose
+    pattern is looked up by their 8 bits of keep.
+
+    narrow16 and narrow32 copy code units of UTF-16 or UTF-32 into bytes for as
+    long as they are ASCII, and return the number copied. big is true if the
+    units are big-endian. A vector of units is tested with one mask that
+    covers the high bits of every unit, and is then packed to bytes with
+    saturation, which can not saturate because the units are small.
+
+    Each kernel has a scalar version, an SSE2 version (16 bytes at a time), and
+    an AVX2 version (32 bytes at a time), except compact, which has an SSSE3
+    version instead. The best one that the processor
+    supports is selected at run time by select_kernels. The vector versions
+    finish the last partial block with the scalar version so that they never
+    read past end.
 */
-    destroy(jc);
-    return FALSE;
+
+static const unsigned char*
+scan_string_scalar(const unsigned char* next, const unsigned char* end, int high)
+{
+    while (next < end && *next >= 0x20 && *next != '"' && *next != '\\' &&
+            (*next & high & 0x80) == 0) {
+        next += 1;
+    }
+    return next;
 }
 
 
-static int
-push(JSON_checker jc, int mode)
+static const unsigned char*
+skip_white_scalar(const unsigned char* next, const unsigned char* end)
 {
-/*
-    Push a mode onto the stack. Return false if there is overflow.
-*/
-    jc->top += 1;
-    if (jc->top >= jc->depth) {
-        return FALSE;
+    while (next < end && (*next == ' ' || *next == '\t' || *next == '\n' ||
+            *next == '\r')) {
+        next += 1;
     }
-    jc->stack[jc->top] = mode;
-    return TRUE;
+    return next;
 }
 
 
-static int
-pop(JSON_checker jc, int mode)
+struct structure_masks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t open;
+    uint64_t close;
+};
+
+
+static void
+structure_block_scalar(const unsigned char* p, struct structure_masks* m)
 {
-/*
-    Pop the stack, assuring that the current mode matches the expectation.
-    Return false if there is underflow or if the modes mismatch.
-*/
-    if (jc->top < 0 || jc->stack[jc->top] != mode) {
-        return FALSE;
+    uint64_t bit;
+    int i;
+
+    m->quote = 0;
+    m->backslash = 0;
+    m->open = 0;
+    m->close = 0;
+    for (i = 0; i < 64; i += 1) {
+        bit = (uint64_t)1 << i;
+        if (p[i] == '"') {
+            m->quote |= bit;
+        } else if (p[i] == '\\') {
+            m->backslash |= bit;
+        } else if ((p[i] | 0x20) == '{') {
+            m->open |= bit;
+        } else if ((p[i] | 0x20) == '}') {
+            m->close |= bit;
+        }
     }
-    jc->top -= 1;
-    return TRUE;
 }
 
 
-JSON_checker
-new_JSON_checker(int depth)
+static size_t
+narrow16_scalar(unsigned char* out, const unsigned char* p, size_t units,
+        int big)
 {
-/*
-    new_JSON_checker starts the checking process by constructing a JSON_checker
-    object. It takes a depth parameter that restricts the level of maximum
-    nesting.
+    size_t i;
+    unsigned unit;
 
-    To continue the process, call JSON_checker_char for each character in the
-    JSON text, and then call JSON_checker_done to obtain the final result.
-    These functions are fully reentrant.
+    for (i = 0; i < units; i += 1) {
+        unit = big
+            ? (unsigned)p[i * 2] << 8 | p[i * 2 + 1]
+            : (unsigned)p[i * 2 + 1] << 8 | p[i * 2];
+        if (unit >= 0x80) {
+            break;
+        }
+        out[i] = (unsigned char)unit;
+    }
+    return i;
+}
 
-    The JSON_checker object will be deleted by JSON_checker_done.
-    JSON_checker_char will delete the JSON_checker object if it sees an error.
-*/
-    JSON_checker jc = (JSON_checker)malloc(sizeof(struct JSON_checker_struct));
-    jc->valid = GOOD;
-    jc->state = GO;
-    jc->depth = depth;
-    jc->top = -1;
-    jc->stack = (int*)calloc(depth, sizeof(int));
-    push(jc, MODE_DONE);
-    return jc;
+
+static size_t
+narrow32_scalar(unsigned char* out, const unsigned char* p, size_t units,
+        int big)
+{
+    size_t i;
+    unsigned long unit;
+
+    for (i = 0; i < units; i += 1) {
+        unit = big
+            ? (unsigned long)p[i * 4] << 24 | (unsigned long)p[i * 4 + 1] << 16 |
+                    (unsigned long)p[i * 4 + 2] << 8 | p[i * 4 + 3]
+            : (unsigned long)p[i * 4 + 3] << 24 | (unsigned long)p[i * 4 + 2] << 16 |
+                    (unsigned long)p[i * 4 + 1] << 8 | p[i * 4];
+        if (unit >= 0x80) {
+            break;
+        }
+        out[i] = (unsigned char)unit;
+    }
+    return i;
 }
 
 
-int
-JSON_checker_char(JSON_checker jc, int next_char)
+static unsigned char*
+compact_scalar(unsigned char* out, const unsigned char* p, uint64_t keep)
 {
-/*
-    After calling new_JSON_checker, call this function for each character (or
-    partial character) in your JSON text. It can accept UTF-8, UTF-16, or
-    UTF-32. It returns TRUE if things are looking ok so far. If it rejects the
-    text, it destroys the JSON_checker object and returns false.
-*/
-    int next_class, next_state;
-/*
-    Determine the character's class.
-*/
-    if (jc->valid != GOOD) {
-        return FALSE;
+    int i;
+
+    if (keep == ~(uint64_t)0) {
+        memcpy(out, p, 64);
+        return out + 64;
     }
-    if (next_char < 0) {
-        return reject(jc);
+    for (i = 0; i < 64; i += 1) {
+        if (keep >> i & 1) {
+            *out = p[i];
+            out += 1;
+        }
     }
-    if (next_char >= 128) {
-        next_class = C_ETC;
-    } else {
-        next_class = ascii_class[next_char];
-        if (next_class <= __) {
-            return reject(jc);
+    return out;
+}
+
+
+#if defined(JSON_CHECKER_X86) && defined(__SSE2__)
+
+static const unsigned char*
+scan_string_sse2(const unsigned char* next, const unsigned char* end, int high)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    while (end - next >= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)next);
+        int mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(x, control), x)
+        )) | (_mm_movemask_epi8(x) & high);
+        if (mask != 0) {
+            return next + __builtin_ctz(mask);
         }
+        next += 16;
     }
-/*
-    Get the next state from the state transition table.
-*/
-    next_state = state_transition_table[jc->state][next_class];
-    if (next_state >= 0) {
-/*
-    Change the state.
-*/
-        jc->state = next_state;
-/*
-    Or perform one of the actions.
-*/
-    } else {
-        switch (next_state) {
-/* empty } */
-        case -9:
-            if (!pop(jc, MODE_KEY)) {
-                return reject(jc);
-            }
-            jc->state = OK;
-            break;
+    return scan_string_scalar(next, end, high);
+}
 
-/* } */ case -8:
-            if (!pop(jc, MODE_OBJECT)) {
-                return reject(jc);
-            }
-            jc->state = OK;
-            break;
 
-/* ] */ case -7:
-            if (!pop(jc, MODE_ARRAY)) {
-                return reject(jc);
-            }
-            jc->state = OK;
-            break;
+static const unsigned char*
+skip_white_sse2(const unsigned char* next, const unsigned char* end)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i linefeed = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    while (end - next >= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)next);
+        int mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(x, linefeed), _mm_cmpeq_epi8(x, carriage))
+        )) ^ 0xFFFF;
+        if (mask != 0) {
+            return next + __builtin_ctz(mask);
+        }
+        next += 16;
+    }
+    return skip_white_scalar(next, end);
+}
 
-/* { */ case -6:
-            if (!push(jc, MODE_KEY)) {
-                return reject(jc);
-            }
-            jc->state = OB;
-            break;
 
-/* [ */ case -5:
-            if (!push(jc, MODE_ARRAY)) {
-                return reject(jc);
-            }
-            jc->state = AR;
-            break;
+static void
+structure_block_sse2(const unsigned char* p, struct structure_masks* m)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    int i;
 
-/* " */ case -4:
-            switch (jc->stack[jc->top]) {
-            case MODE_KEY:
-                jc->state = CO;
-                break;
-            case MODE_ARRAY:
-            case MODE_OBJECT:
-                jc->state = OK;
-                break;
-            default:
-                return reject(jc);
-            }
+    m->quote = 0;
+    m->backslash = 0;
+    m->open = 0;
+    m->close = 0;
+    for (i = 0; i < 64; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i y = _mm_or_si128(x, lower);
+        m->quote |= (uint64_t)(unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(x, quote)
+        ) << i;
+        m->backslash |= (uint64_t)(unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(x, backslash)
+        ) << i;
+        m->open |= (uint64_t)(unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(y, open)
+        ) << i;
+        m->close |= (uint64_t)(unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(y, close)
+        ) << i;
+    }
+}
+
+
+static size_t
+narrow16_sse2(unsigned char* out, const unsigned char* p, size_t units,
+        int big)
+{
+    const __m128i high = _mm_set1_epi16(big
+        ? (short)0x80FF
+        : (short)0xFF80);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    while (units - i >= 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(p + i * 2));
+        __m128i b = _mm_loadu_si128((const __m128i*)(p + i * 2 + 16));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(
+            _mm_and_si128(_mm_or_si128(a, b), high),
+            zero
+        )) != 0xFFFF) {
             break;
+        }
+        if (big) {
+            a = _mm_srli_epi16(a, 8);
+            b = _mm_srli_epi16(b, 8);
+        }
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(a, b));
+        i += 16;
+    }
+    return i + narrow16_scalar(out + i, p + i * 2, units - i, big);
+}
 
-/* , */ case -3:
-            switch (jc->stack[jc->top]) {
-            case MODE_OBJECT:
-/*
-    A comma causes a flip from object mode to key mode.
-*/
-                if (!pop(jc, MODE_OBJECT) || !push(jc, MODE_KEY)) {
-                    return reject(jc);
-                }
-                jc->state = KE;
-                break;
-            case MODE_ARRAY:
-                jc->state = VA;
-                break;
-            default:
-                return reject(jc);
-            }
+
+static size_t
+narrow32_sse2(unsigned char* out, const unsigned char* p, size_t units,
+        int big)
+{
+    const __m128i high = _mm_set1_epi32(big
+        ? (int)0x80FFFFFF
+        : (int)0xFFFFFF80);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    while (units - i >= 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(p + i * 4));
+        __m128i b = _mm_loadu_si128((const __m128i*)(p + i * 4 + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(p + i * 4 + 32));
+        __m128i d = _mm_loadu_si128((const __m128i*)(p + i * 4 + 48));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(
+            _mm_and_si128(
+                _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)),
+                high
+            ),
+            zero
+        )) != 0xFFFF) {
             break;
+        }
+        if (big) {
+            a = _mm_srli_epi32(a, 24);
+            b = _mm_srli_epi32(b, 24);
+            c = _mm_srli_epi32(c, 24);
+            d = _mm_srli_epi32(d, 24);
+        }
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(
+            _mm_packs_epi32(a, b),
+            _mm_packs_epi32(c, d)
+        ));
+        i += 16;
+    }
+    return i + narrow32_scalar(out + i, p + i * 4, units - i, big);
+}
+
+#endif
+
+
+#if defined(JSON_CHECKER_X86)
+
+__attribute__((target("avx2")))
+static const unsigned char*
+scan_string_avx2(const unsigned char* next, const unsigned char* end, int high)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    while (end - next >= 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)next);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(x, control), x)
+        )) | ((unsigned)_mm256_movemask_epi8(x) & (unsigned)high);
+        if (mask != 0) {
+            return next + __builtin_ctz(mask);
+        }
+        next += 32;
+    }
+    return scan_string_scalar(next, end, high);
+}
 
-/* : */ case -2:
+
+__attribute__((target("avx2")))
+static const unsigned char*
+skip_white_avx2(const unsigned char* next, const unsigned char* end)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i linefeed = _mm256_set1_epi8('\n');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+    while (end - next >= 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)next);
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, space), _mm256_cmpeq_epi8(x, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, linefeed), _mm256_cmpeq_epi8(x, carriage))
+        ));
+        if (mask != 0) {
+            return next + __builtin_ctz(mask);
+        }
+        next += 32;
+    }
+    return skip_white_scalar(next, end);
+}
+
+
+__attribute__((target("avx2")))
+static void
+structure_block_avx2(const unsigned char* p, struct structure_masks* m)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    __m256i x = _mm256_loadu_si256((const __m256i*)p);
+    __m256i z = _mm256_loadu_si256((const __m256i*)(p + 32));
+    __m256i y = _mm256_or_si256(x, lower);
+    __m256i w = _mm256_or_si256(z, lower);
+
+    m->quote = (uint64_t)(unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(x, quote)
+    ) | (uint64_t)(unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(z, quote)
+    ) << 32;
+    m->backslash = (uint64_t)(unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(x, backslash)
+    ) | (uint64_t)(unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(z, backslash)
+    ) << 32;
+    m->open = (uint64_t)(unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(y, open)
+    ) | (uint64_t)(unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(w, open)
+    ) << 32;
+    m->close = (uint64_t)(unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(y, close)
+    ) | (uint64_t)(unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(w, close)
+    ) << 32;
+}
+
+
+__attribute__((target("avx2")))
+static size_t
+narrow16_avx2(unsigned char* out, const unsigned char* p, size_t units,
+        int big)
+{
+    const __m256i high = _mm256_set1_epi16(big
+        ? (short)0x80FF
+        : (short)0xFF80);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+
+    while (units - i >= 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(p + i * 2));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(p + i * 2 + 32));
+        if ((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi16(
+            _mm256_and_si256(_mm256_or_si256(a, b), high),
+            zero
+        )) != 0xFFFFFFFFu) {
+            break;
+        }
+        if (big) {
+            a = _mm256_srli_epi16(a, 8);
+            b = _mm256_srli_epi16(b, 8);
+        }
 /*
-    A colon causes a flip from key mode to object mode.
+    The packs work within 128-bit lanes, so the quarters are put back in order.
 */
-            if (!pop(jc, MODE_KEY) || !push(jc, MODE_OBJECT)) {
-                return reject(jc);
-            }
-            jc->state = VA;
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(
+            _mm256_packus_epi16(a, b),
+            0xD8
+        ));
+        i += 32;
+    }
+    return i + narrow16_scalar(out + i, p + i * 2, units - i, big);
+}
+
+
+__attribute__((target("avx2")))
+static size_t
+narrow32_avx2(unsigned char* out, const unsigned char* p, size_t units,
+        int big)
+{
+    const __m256i high = _mm256_set1_epi32(big
+        ? (int)0x80FFFFFF
+        : (int)0xFFFFFF80);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+
+    while (units - i >= 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(p + i * 4));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(p + i * 4 + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(p + i * 4 + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(p + i * 4 + 96));
+        if ((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi32(
+            _mm256_and_si256(
+                _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d)),
+                high
+            ),
+            zero
+        )) != 0xFFFFFFFFu) {
             break;
+        }
+        if (big) {
+            a = _mm256_srli_epi32(a, 24);
+            b = _mm256_srli_epi32(b, 24);
+            c = _mm256_srli_epi32(c, 24);
+            d = _mm256_srli_epi32(d, 24);
+        }
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permutevar8x32_epi32(
+            _mm256_packus_epi16(
+                _mm256_packs_epi32(a, b),
+                _mm256_packs_epi32(c, d)
+            ),
+            order
+        ));
+        i += 32;
+    }
+    return i + narrow32_scalar(out + i, p + i * 4, units - i, big);
+}
+
+
 /*
-    Bad action.
+    compact_shuffle[bits] moves the bytes of a group of 8 whose bits are set to
+    the front, one index per byte, lowest first.
 */
-        default:
-            return reject(jc);
+
+static const uint64_t compact_shuffle[256] = {
+    0x0000000000000000, 0x0000000000000000, 0x0000000000000001,
+    0x0000000000000100, 0x0000000000000002, 0x0000000000000200,
+    0x0000000000000201, 0x0000000000020100, 0x0000000000000003,
+    0x0000000000000300, 0x0000000000000301, 0x0000000000030100,
+    0x0000000000000302, 0x0000000000030200, 0x0000000000030201,
+    0x0000000003020100, 0x0000000000000004, 0x0000000000000400,
+    0x0000000000000401, 0x0000000000040100, 0x0000000000000402,
+    0x0000000000040200, 0x0000000000040201, 0x0000000004020100,
+    0x0000000000000403, 0x0000000000040300, 0x0000000000040301,
+    0x0000000004030100, 0x0000000000040302, 0x0000000004030200,
+    0x0000000004030201, 0x0000000403020100, 0x0000000000000005,
+    0x0000000000000500, 0x0000000000000501, 0x0000000000050100,
+    0x0000000000000502, 0x0000000000050200, 0x0000000000050201,
+    0x0000000005020100, 0x0000000000000503, 0x0000000000050300,
+    0x0000000000050301, 0x0000000005030100, 0x0000000000050302,
+    0x0000000005030200, 0x0000000005030201, 0x0000000503020100,
+    0x0000000000000504, 0x0000000000050400, 0x0000000000050401,
+    0x0000000005040100, 0x0000000000050402, 0x0000000005040200,
+    0x0000000005040201, 0x0000000504020100, 0x0000000000050403,
+    0x0000000005040300, 0x0000000005040301, 0x0000000504030100,
+    0x0000000005040302, 0x0000000504030200, 0x0000000504030201,
+    0x0000050403020100, 0x0000000000000006, 0x0000000000000600,
+    0x0000000000000601, 0x0000000000060100, 0x0000000000000602,
+    0x0000000000060200, 0x0000000000060201, 0x0000000006020100,
+    0x0000000000000603, 0x0000000000060300, 0x0000000000060301,
+    0x0000000006030100, 0x0000000000060302, 0x0000000006030200,
+    0x0000000006030201, 0x0000000603020100, 0x0000000000000604,
+    0x0000000000060400, 0x0000000000060401, 0x0000000006040100,
+    0x0000000000060402, 0x0000000006040200, 0x0000000006040201,
+    0x0000000604020100, 0x0000000000060403, 0x0000000006040300,
+    0x0000000006040301, 0x0000000604030100, 0x0000000006040302,
+    0x0000000604030200, 0x0000000604030201, 0x0000060403020100,
+    0x0000000000000605, 0x0000000000060500, 0x0000000000060501,
+    0x0000000006050100, 0x0000000000060502, 0x0000000006050200,
+    0x0000000006050201, 0x0000000605020100, 0x0000000000060503,
+    0x0000000006050300, 0x0000000006050301, 0x0000000605030100,
+    0x0000000006050302, 0x0000000605030200, 0x0000000605030201,
+    0x0000060503020100, 0x0000000000060504, 0x0000000006050400,
+    0x0000000006050401, 0x0000000605040100, 0x0000000006050402,
+    0x0000000605040200, 0x0000000605040201, 0x0000060504020100,
+    0x0000000006050403, 0x0000000605040300, 0x0000000605040301,
+    0x0000060504030100, 0x0000000605040302, 0x0000060504030200,
+    0x0000060504030201, 0x0006050403020100, 0x0000000000000007,
+    0x0000000000000700, 0x0000000000000701, 0x0000000000070100,
+    0x0000000000000702, 0x0000000000070200, 0x0000000000070201,
+    0x0000000007020100, 0x0000000000000703, 0x0000000000070300,
+    0x0000000000070301, 0x0000000007030100, 0x0000000000070302,
+    0x0000000007030200, 0x0000000007030201, 0x0000000703020100,
+    0x0000000000000704, 0x0000000000070400, 0x0000000000070401,
+    0x0000000007040100, 0x0000000000070402, 0x0000000007040200,
+    0x0000000007040201, 0x0000000704020100, 0x0000000000070403,
+    0x0000000007040300, 0x0000000007040301, 0x0000000704030100,
+    0x0000000007040302, 0x0000000704030200, 0x0000000704030201,
+    0x0000070403020100, 0x0000000000000705, 0x0000000000070500,
+    0x0000000000070501, 0x0000000007050100, 0x0000000000070502,
+    0x0000000007050200, 0x0000000007050201, 0x0000000705020100,
+    0x0000000000070503, 0x0000000007050300, 0x0000000007050301,
+    0x0000000705030100, 0x0000000007050302, 0x0000000705030200,
+    0x0000000705030201, 0x0000070503020100, 0x0000000000070504,
+    0x0000000007050400, 0x0000000007050401, 0x0000000705040100,
+    0x0000000007050402, 0x0000000705040200, 0x0000000705040201,
+    0x0000070504020100, 0x0000000007050403, 0x0000000705040300,
+    0x0000000705040301, 0x0000070504030100, 0x0000000705040302,
+    0x0000070504030200, 0x0000070504030201, 0x0007050403020100,
+    0x0000000000000706, 0x0000000000070600, 0x0000000000070601,
+    0x0000000007060100, 0x0000000000070602, 0x0000000007060200,
+    0x0000000007060201, 0x0000000706020100, 0x0000000000070603,
+    0x0000000007060300, 0x0000000007060301, 0x0000000706030100,
+    0x0000000007060302, 0x0000000706030200, 0x0000000706030201,
+    0x0000070603020100, 0x0000000000070604, 0x0000000007060400,
+    0x0000000007060401, 0x0000000706040100, 0x0000000007060402,
+    0x0000000706040200, 0x0000000706040201, 0x0000070604020100,
+    0x0000000007060403, 0x0000000706040300, 0x0000000706040301,
+    0x0000070604030100, 0x0000000706040302, 0x0000070604030200,
+    0x0000070604030201, 0x0007060403020100, 0x0000000000070605,
+    0x0000000007060500, 0x0000000007060501, 0x0000000706050100,
+    0x0000000007060502, 0x0000000706050200, 0x0000000706050201,
+    0x0000070605020100, 0x0000000007060503, 0x0000000706050300,
+    0x0000000706050301, 0x0000070605030100, 0x0000000706050302,
+    0x0000070605030200, 0x0000070605030201, 0x0007060503020100,
+    0x0000000007060504, 0x0000000706050400, 0x0000000706050401,
+    0x0000070605040100, 0x0000000706050402, 0x0000070605040200,
+    0x0000070605040201, 0x0007060504020100, 0x0000000706050403,
+    0x0000070605040300, 0x0000070605040301, 0x0007060504030100,
+    0x0000070605040302, 0x0007060504030200, 0x0007060504030201,
+    0x0706050403020100
+};
+
+
+__attribute__((target("ssse3,popcnt")))
+static unsigned char*
+compact_ssse3(unsigned char* out, const unsigned char* p, uint64_t keep)
+{
+    const __m128i high = _mm_set_epi64x(0x0808080808080808LL, 0);
+    int i;
+
+    for (i = 0; i < 64; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+        unsigned low_bits = (unsigned)(keep >> i) & 0xFF;
+        unsigned high_bits = (unsigned)(keep >> (i + 8)) & 0xFF;
+        if ((low_bits & high_bits) == 0xFF) {
+            _mm_storeu_si128((__m128i*)out, x);
+            out += 16;
+        } else {
+            __m128i y = _mm_shuffle_epi8(x, _mm_add_epi8(
+                _mm_set_epi64x(
+                    (long long)compact_shuffle[high_bits],
+                    (long long)compact_shuffle[low_bits]
+                ),
+                high
+            ));
+            _mm_storel_epi64((__m128i*)out, y);
+            out += __builtin_popcount(low_bits);
+            _mm_storel_epi64((__m128i*)out, _mm_unpackhi_epi64(y, y));
+            out += __builtin_popcount(high_bits);
         }
     }
-    return TRUE;
+    return out;
 }
 
+#endif
 
-int
-JSON_checker_done(JSON_checker jc)
+
+static const unsigned char* (*scan_string)(
+    const unsigned char* next,
+    const unsigned char* end,
+    int high
+) = scan_string_scalar;
+
+static const unsigned char* (*skip_white)(
+    const unsigned char* next,
+    const unsigned char* end
+) = skip_white_scalar;
+
+static void (*structure_block)(
+    const unsigned char* p,
+    struct structure_masks* m
+) = structure_block_scalar;
+
+static unsigned char* (*compact)(
+    unsigned char* out,
+    const unsigned char* p,
+    uint64_t keep
+) = compact_scalar;
+
+static size_t (*narrow16)(
+    unsigned char* out,
+    const unsigned char* p,
+    size_t units,
+    int big
+) = narrow16_scalar;
+
+static size_t (*narrow32)(
+    unsigned char* out,
+    const unsigned char* p,
+    size_t units,
+    int big
+) = narrow32_scalar;
+
+static pthread_once_t kernels_selected = PTHREAD_ONCE_INIT;
+
+
+static void
+select_kernels(void)
 {
 /*
-    The JSON_checker_done function should be called after all of the characters
-    have been processed, but only if every call to JSON_checker_char returned
-    true. This function deletes the JSON_checker and returns true if the JSON
-    text was accepted.
+    Choose the fastest kernels that this processor can run. This is done once,
+    through pthread_once, before the first JSON_checker is made, so the
+    pointers are never written while another thread reads them.
 */
-    if (jc->valid != GOOD) {
-        return FALSE;
+#if defined(JSON_CHECKER_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("popcnt")) {
+        compact = compact_ssse3;
     }
-    int result = jc->state == OK && pop(jc, MODE_DONE);
-    destroy(jc);
-    return result;
+    if (__builtin_cpu_supports("avx2")) {
+        scan_string = scan_string_avx2;
+        skip_white = skip_white_avx2;
+        structure_block = structure_block_avx2;
+        narrow16 = narrow16_avx2;
+        narrow32 = narrow32_avx2;
+        return;
+    }
+#if defined(__SSE2__)
+    scan_string = scan_string_sse2;
+    skip_white = skip_white_sse2;
+    structure_block = structure_block_sse2;
+    narrow16 = narrow16_sse2;
+    narrow32 = narrow32_sse2;
+#endif
+#endif
+}
+
+
+/*
+    Strict UTF-8.
+
+    With the JSON_CHECKER_UTF8 option, the multibyte sequences inside of
+    strings are checked with the same rules as utf8_decode_next: no overlong
+    forms, no surrogates, and nothing above U+10FFFF. jc->utf8 holds the
+    position within the current sequence: 0 between characters, otherwise a
+    row of these tables, which give the range allowed for the next byte and
+    the position that follows it.
+
+        1   last continuation byte
+        2   two continuation bytes left
+        3   after E0, which must not be overlong
+        4   after ED, which must not be a surrogate
+        5   three continuation bytes left
+        6   after F0, which must not be overlong
+        7   after F4, which must not exceed U+10FFFF
+*/
+
+static const uint8_t utf8_low[8] =  {0, 0x80, 0x80, 0xA0, 0x80, 0x80, 0x90, 0x80};
+static const uint8_t utf8_high[8] = {0, 0xBF, 0xBF, 0xBF, 0x9F, 0xBF, 0xBF, 0x8F};
+static const uint8_t utf8_after[8] = {0, 0, 1, 1, 1, 2, 2, 2};
+
+
+static int
+utf8_lead(int c)
+{
+/*
+    Return the position after the first byte c of a multibyte sequence, or -1
+    if c can not begin one.
+*/
+    if (c < 0xC2) {
+        return -1;
+    }
+    if (c < 0xE0) {
+        return 1;
+    }
+    if (c == 0xE0) {
+        return 3;
+    }
+    if (c == 0xED) {
+        return 4;
+    }
+    if (c < 0xF0) {
+        return 2;
+    }
+    if (c == 0xF0) {
+        return 6;
+    }
+    if (c < 0xF4) {
+        return 5;
+    }
+    if (c == 0xF4) {
+        return 7;
+    }
+    return -1;
+}
+
+
+static int
+utf8_step(int* utf8, int c)
+{
+/*
+    Advance the UTF-8 position past the byte c. Return false if c is not
+    allowed here.
+*/
+    int position = *utf8;
+    if (position == 0) {
+        if (c < 0x80) {
+            return TRUE;
+        }
+        position = utf8_lead(c);
+        if (position < 0) {
+            return FALSE;
+        }
+    } else {
+        if (c < utf8_low[position] || c > utf8_high[position]) {
+            return FALSE;
+        }
+        position = utf8_after[position];
+    }
+    *utf8 = position;
+    return TRUE;
+}
+
+
+static const unsigned char*
+scan_strict_string(int* utf8, const unsigned char* next,
+        const unsigned char* end)
+{
+/*
+    Like scan_string, but also check the UTF-8 multibyte sequences, a byte at
+    a time, while skipping the ASCII between them at full speed. Return NULL if
+    a sequence is not allowed.
+*/
+    for (;;) {
+        if (*utf8 == 0) {
+            next = scan_string(next, end, ~0);
+            if (next == end || *next < 0x80) {
+                return next;
+            }
+        }
+        if (next == end) {
+            return next;
+        }
+        if (!utf8_step(utf8, *next)) {
+            return NULL;
+        }
+        next += 1;
+    }
+}
+
+
+static void
+destroy(JSON_checker jc)
+{
+/*
+    Delete the JSON_checker object.
+*/
+    jc->valid = 0;
+    JSON_checker_release(jc);
+    free((void*)jc);
+}
+
+
+static int
+reject(JSON_checker jc)
+{
+/*
+    Delete the JSON_checker object. If the object lives in storage that was
+    provided by the caller, it is not deleted, but it will not accept any more
+    characters until it is reset.
+*/
+    if (jc->allocated) {
+        destroy(jc);
+    } else {
+        jc->valid = 0;
+    }
+    return FALSE;
+}
+
+
+static const char* const class_names[NR_CLASSES] = {
+    "space", "whitespace", "{", "}", "[", "]", ":", ",", "quote", "backslash",
+    "/", "+", "-", ".", "0", "digit", "a", "b", "c", "d", "e", "f", "l", "n",
+    "r", "s", "t", "u", "ABCDF", "E", "other character", "control character"
+};
+
+static const char* const state_names[NR_STATES] = {
+    "start", "ok", "object", "key", "colon", "value", "array", "string",
+    "escape", "u1", "u2", "u3", "u4", "minus", "zero", "integer", "fraction",
+    "fraction", "e", "ex", "exp", "tr", "tru", "true", "fa", "fal", "fals",
+    "false", "nu", "nul", "null"
+};
+
+
+static int
+fail(JSON_checker jc, size_t offset, int character)
+{
+/*
+    Reject the text, first filling in the caller's error record, if there is
+    one. offset is the position of the offending character. character is that
+    byte, -1 at the end of the text, or NO_MEMORY if memory ran out. Line and
+    column are left for JSON_error_locate.
+*/
+    JSON_error error = jc->error;
+    if (error != NULL) {
+        error->offset = offset;
+        error->line = 0;
+        error->column = 0;
+        error->character = character;
+        error->depth = jc->top;
+        error->state = state_names[jc->state];
+        if (character == NO_MEMORY) {
+            error->character_class = "out of memory";
+        } else if (character < 0) {
+            error->character_class = "end of text";
+        } else if (character >= 0x80 && character < 256 &&
+                (jc->options & JSON_CHECKER_UTF8) && jc->state == ST) {
+            error->character_class = "invalid UTF-8";
+        } else {
+            error->character_class = class_names[(character < 256)
+                ? byte_class[character]
+                : C_ETC];
+        }
+    }
+    return reject(jc);
+}
+
+
+static const unsigned char*
+find_bad_utf8(int utf8, const unsigned char* next)
+{
+/*
+    Find the byte at which scan_strict_string failed, by stepping again from
+    where it began. This is only done after an error.
+*/
+    while (utf8_step(&utf8, *next)) {
+        next += 1;
+    }
+    return next;
+}
+
+
+/*
+    The mode stack is packed 2 bits per level into 64-bit words. The first
+    JSON_CHECKER_INLINE_WORDS words are kept inside of the JSON_checker_struct,
+    which is enough for most texts. Deeper texts cause the stack to be moved
+    to the heap, where it doubles as needed, up to the maximum depth.
+*/
+
+#define LEVELS_PER_WORD 32
+
+
+static int
+top_mode(JSON_checker jc)
+{
+/*
+    Return the mode at the top of the stack.
+*/
+    return (int)(jc->stack[jc->top / LEVELS_PER_WORD] >>
+            (jc->top % LEVELS_PER_WORD * 2)) & 3;
+}
+
+
+static int
+grow(JSON_checker jc)
+{
+/*
+    Make room for more levels on the stack. Return false if memory is not
+    available.
+*/
+    int size = jc->size * 2;
+    uint64_t* stack;
+    if (size > jc->depth) {
+        size = jc->depth;
+    }
+    if (jc->stack == jc->inline_stack) {
+        stack = (uint64_t*)malloc(
+            (size + LEVELS_PER_WORD - 1) / LEVELS_PER_WORD * sizeof(uint64_t)
+        );
+        if (stack != NULL) {
+            memcpy(stack, jc->inline_stack, sizeof(jc->inline_stack));
+        }
+    } else {
+        stack = (uint64_t*)realloc(
+            jc->stack,
+            (size + LEVELS_PER_WORD - 1) / LEVELS_PER_WORD * sizeof(uint64_t)
+        );
+    }
+    if (stack == NULL) {
+        return FALSE;
+    }
+    jc->stack = stack;
+    jc->size = size;
+    return TRUE;
+}
+
+
+static int
+push(JSON_checker jc, int mode)
+{
+/*
+    Push a mode onto the stack. Return false if there is overflow.
+*/
+    uint64_t* word;
+    int shift;
+
+    jc->top += 1;
+    if (jc->top >= jc->depth) {
+        return FALSE;
+    }
+    if (jc->top >= jc->size && !grow(jc)) {
+        return FALSE;
+    }
+    word = &jc->stack[jc->top / LEVELS_PER_WORD];
+    shift = jc->top % LEVELS_PER_WORD * 2;
+    *word = (*word & ~((uint64_t)3 << shift)) | ((uint64_t)mode << shift);
+    return TRUE;
+}
+
+
+static int
+pop(JSON_checker jc, int mode)
+{
+/*
+    Pop the stack, assuring that the current mode matches the expectation.
+    Return false if there is underflow or if the modes mismatch.
+*/
+    if (jc->top < 0 || top_mode(jc) != mode) {
+        return FALSE;
+    }
+    jc->top -= 1;
+    return TRUE;
+}
+
+
+/*
+    Statistics
+
+    With JSON_CHECKER_STATS defined, every byte that goes through the state
+    transition table is counted by count_byte. The kernels are not touched.
+    Instead, the bytes that they skip are counted by position: the gap
+    between the last byte that was counted and this one was either the
+    inside of a string or whitespace, according to the state. The lengths of
+    strings and numbers are also found from their offsets. count_rest counts
+    the whitespace at the end of a text, and COUNT_SKIP moves past bytes that
+    are not to be counted at all.
+
+    Without JSON_CHECKER_STATS, the macros are empty, and nothing is added to
+    the paths.
+*/
+
+#if defined(JSON_CHECKER_STATS)
+
+static void
+count_byte(JSON_checker jc, size_t at, int state, int next_state,
+        int next_class)
+{
+    JSON_stats stats = jc->stats;
+    size_t gap = at - stats->last;
+
+    if (next_state == 255) {
+        return;
+    }
+    if (state == ST) {
+        stats->string_bytes += gap;
+    } else {
+        stats->white_bytes += gap;
+    }
+    stats->last = at + 1;
+    if (state >= MI && state <= E3 && (next_state >= NR_STATES ||
+            next_state == OK) && at - stats->number_start >
+            stats->longest_number) {
+        stats->longest_number = at - stats->number_start;
+    }
+    if (next_state >= NR_STATES) {
+        stats->actions[256 - next_state] += 1;
+        if (next_state == 252) {
+            stats->string_bytes += 1;
+            if (at - stats->string_start - 1 > stats->longest_string) {
+                stats->longest_string = at - stats->string_start - 1;
+            }
+        } else {
+            stats->structure_bytes += 1;
+            if ((next_state == 251 || next_state == 250) &&
+                    jc->top + 1 > stats->max_depth) {
+                stats->max_depth = jc->top + 1;
+            }
+        }
+    } else if (next_state >= ST && next_state <= U4) {
+        stats->string_bytes += 1;
+        if (state <= AR) {
+            stats->string_start = at;
+        } else if (state == ST && next_class == C_BACKS) {
+            stats->escapes += 1;
+        } else if (state == ES && next_class == C_LOW_U) {
+            stats->unicode_escapes += 1;
+        }
+    } else if (next_state >= MI && next_state <= E3) {
+        stats->number_bytes += 1;
+        if (state <= AR) {
+            stats->number_start = at;
+        }
+    } else if (next_state >= T1 || state >= T1) {
+        stats->literal_bytes += 1;
+    } else {
+        stats->white_bytes += 1;
+    }
+}
+
+
+static void
+count_rest(JSON_checker jc)
+{
+    jc->stats->white_bytes += jc->offset - jc->stats->last;
+    jc->stats->last = jc->offset;
+}
+
+#define COUNT_BYTE(jc, at, state, next_state, next_class) \
+    if (UNLIKELY((jc)->stats != NULL)) { \
+        count_byte((jc), (at), (state), (next_state), (next_class)); \
+    }
+#define COUNT_REST(jc) \
+    if ((jc)->stats != NULL) { \
+        count_rest(jc); \
+    }
+#define COUNT_SKIP(jc, at) \
+    if ((jc)->stats != NULL) { \
+        (jc)->stats->last = (at); \
+    }
+
+#else
+
+#define COUNT_BYTE(jc, at, state, next_state, next_class)
+#define COUNT_REST(jc)
+#define COUNT_SKIP(jc, at)
+
+#endif
+
+
+/*
+    Selection
+
+    A JSON_select_cursor follows the path of the JSON_checker through the text
+    for a JSON_select. It has an entry for each level of the stack, up to the
+    length of the longest pointer, which is as deep as selection ever goes:
+    a container that no pointer reaches into is passed over instead.
+
+    Pointers are sets of bits. live[level] is the set of pointers that go
+    through the container at that level, and matched[level] the set whose
+    value it is. ends[level] is the set of pointers that have exactly level
+    tokens. count[level] is the index of the next element of an array.
+*/
+
+#define SELECT_MAX 64
+
+struct JSON_select_cursor {
+    int levels;
+    uint64_t all;           /* every pointer */
+    uint64_t started;       /* pointers whose value has begun */
+    uint64_t found;         /* pointers whose value has ended */
+    uint64_t next;          /* the pointers that the current key leads to */
+    uint64_t scalar;        /* the pointers whose scalar value is open */
+    uint64_t skip_matched;  /* the pointers whose value is being passed over */
+    int skip;               /* brackets left open in the part passed over */
+    int skip_levels;        /* levels of the stack that the part closes */
+    int in_string;          /* the part passed over is in a string */
+    int escape;             /* and after a backslash */
+    int in_key;             /* a key is being read */
+    uint64_t* ends;
+    uint64_t* live;
+    uint64_t* matched;
+    size_t* count;
+};
+
+
+static void
+select_reset(JSON_checker jc)
+{
+/*
+    Forget the values found in the last text.
+*/
+    struct JSON_select_cursor* cursor = jc->cursor;
+    int i;
+
+    for (i = 0; i < jc->select->count; i += 1) {
+        jc->select->offsets[i] = 0;
+        jc->select->lengths[i] = 0;
+    }
+    cursor->started = 0;
+    cursor->found = 0;
+    cursor->next = 0;
+    cursor->scalar = 0;
+    cursor->skip = 0;
+    cursor->in_string = FALSE;
+    cursor->escape = FALSE;
+    cursor->in_key = FALSE;
+}
+
+
+JSON_checker
+new_JSON_checker(int depth)
+{
+/*
+    new_JSON_checker starts the checking process by constructing a JSON_checker
+    object. It takes a depth parameter that restricts the level of maximum
+    nesting. Memory for the nesting is only taken as it is needed, so a large
+    depth costs nothing until a text actually nests that deeply.
+
+    To continue the process, call JSON_checker_char for each character in the
+    JSON text, and then call JSON_checker_done to obtain the final result.
+    These functions are fully reentrant.
+
+    The JSON_checker object will be deleted by JSON_checker_done.
+    JSON_checker_char will delete the JSON_checker object if it sees an error.
+*/
+    JSON_checker jc = (JSON_checker)malloc(sizeof(struct JSON_checker_struct));
+    init_JSON_checker(jc, depth);
+    jc->allocated = TRUE;
+    return jc;
+}
+
+
+JSON_checker
+init_JSON_checker(struct JSON_checker_struct* jc, int depth)
+{
+/*
+    init_JSON_checker is like new_JSON_checker, except that it does not
+    allocate the object. The caller provides the JSON_checker_struct, which
+    can be on the stack or in an arena. Nothing is allocated unless a text
+    nests deeper than the stack kept inside of the struct.
+
+    Such a JSON_checker is never deleted. When JSON_checker_char rejects the
+    text, or when JSON_checker_done is called, it stops accepting characters.
+    JSON_checker_reset prepares it for the next JSON text. When it is no
+    longer needed, JSON_checker_release frees anything it allocated.
+*/
+    pthread_once(&kernels_selected, select_kernels);
+    jc->allocated = FALSE;
+    jc->options = 0;
+    jc->index = NULL;
+    jc->handler = NULL;
+    jc->error = NULL;
+    jc->select = NULL;
+    jc->cursor = NULL;
+    jc->minify = NULL;
+    jc->stats = NULL;
+    jc->spill = NULL;
+    jc->spill_size = 0;
+    jc->depth = depth;
+    jc->size = JSON_CHECKER_INLINE_WORDS * LEVELS_PER_WORD;
+    jc->stack = jc->inline_stack;
+    JSON_checker_reset(jc);
+    return jc;
+}
+
+
+void
+JSON_checker_reset(JSON_checker jc)
+{
+/*
+    Return the JSON_checker to its initial state so that it can check another
+    JSON text with the same depth.
+*/
+    jc->valid = GOOD;
+    jc->state = GO;
+    jc->utf8 = 0;
+    jc->offset = 0;
+    jc->spill_length = 0;
+    jc->encoding = ENCODING_NONE;
+    jc->surrogate = FALSE;
+    jc->partial_length = 0;
+    jc->top = -1;
+    push(jc, MODE_DONE);
+    if (jc->select != NULL) {
+        select_reset(jc);
+    }
+    COUNT_SKIP(jc, 0);
+}
+
+
+void
+JSON_checker_set_options(JSON_checker jc, int options)
+{
+/*
+    Select optional checks. This should be done before the first character.
+    The options are kept across JSON_checker_reset.
+*/
+    jc->options = options;
+}
+
+
+void
+JSON_checker_set_index(JSON_checker jc, JSON_index index)
+{
+/*
+    Start or stop recording the structure of the text. Like the options, the
+    index is kept across JSON_checker_reset.
+*/
+    jc->index = index;
+}
+
+
+void
+JSON_checker_set_handler(JSON_checker jc, JSON_handler handler)
+{
+/*
+    Start or stop delivering events. The handler is kept across
+    JSON_checker_reset.
+*/
+    jc->handler = handler;
+}
+
+
+int
+JSON_checker_set_select(JSON_checker jc, JSON_select select)
+{
+/*
+    Start or stop selecting. The cursor is made here, in one allocation, with
+    room for the longest of the pointers.
+*/
+    struct JSON_select_cursor* cursor;
+    const char* p;
+    int levels = 0;
+    int tokens;
+    int i;
+
+    free((void*)jc->cursor);
+    jc->cursor = NULL;
+    jc->select = NULL;
+    if (select == NULL) {
+        return TRUE;
+    }
+    if (select->count < 0 || select->count > SELECT_MAX) {
+        return FALSE;
+    }
+    for (i = 0; i < select->count; i += 1) {
+        tokens = 0;
+        for (p = select->pointers[i]; *p != 0; p += 1) {
+            tokens += *p == '/';
+        }
+        if (tokens > levels) {
+            levels = tokens;
+        }
+    }
+    levels += 2;
+    cursor = (struct JSON_select_cursor*)malloc(
+        sizeof(struct JSON_select_cursor) +
+        levels * (3 * sizeof(uint64_t) + sizeof(size_t))
+    );
+    if (cursor == NULL) {
+        return FALSE;
+    }
+    cursor->levels = levels;
+    cursor->ends = (uint64_t*)(cursor + 1);
+    cursor->live = cursor->ends + levels;
+    cursor->matched = cursor->live + levels;
+    cursor->count = (size_t*)(cursor->matched + levels);
+    memset(cursor->ends, 0, levels * sizeof(uint64_t));
+    cursor->all = 0;
+    for (i = 0; i < select->count; i += 1) {
+/*
+    A pointer that does not begin with a slash names nothing.
+*/
+        p = select->pointers[i];
+        if (*p == 0 || *p == '/') {
+            tokens = 0;
+            for (; *p != 0; p += 1) {
+                tokens += *p == '/';
+            }
+            cursor->ends[tokens] |= (uint64_t)1 << i;
+            cursor->all |= (uint64_t)1 << i;
+        }
+    }
+    jc->select = select;
+    jc->cursor = cursor;
+    select_reset(jc);
+    return TRUE;
+}
+
+
+static int
+index_add(JSON_index index, size_t offset)
+{
+/*
+    Append an offset to the index, doubling its array when it is full. Return
+    false if the offset does not fit or if memory runs out.
+*/
+    size_t capacity;
+    uint32_t* offsets;
+
+    if (offset > UINT32_MAX) {
+        return FALSE;
+    }
+    if (index->count == index->capacity) {
+        capacity = (index->capacity > 0) ? index->capacity * 2 : 1024;
+        offsets = (uint32_t*)realloc(
+            index->offsets,
+            capacity * sizeof(uint32_t)
+        );
+        if (offsets == NULL) {
+            return FALSE;
+        }
+        index->offsets = offsets;
+        index->capacity = capacity;
+    }
+    index->offsets[index->count] = (uint32_t)offset;
+    index->count += 1;
+    return TRUE;
+}
+
+
+void
+JSON_checker_set_minify(JSON_checker jc, JSON_minify minify)
+{
+/*
+    Start or stop minifying. The minify is kept across JSON_checker_reset.
+*/
+    jc->minify = minify;
+}
+
+
+int
+JSON_checker_set_stats(JSON_checker jc, JSON_stats stats)
+{
+/*
+    Start or stop counting. The count of bytes starts from where the
+    JSON_checker is now.
+*/
+#if defined(JSON_CHECKER_STATS)
+    jc->stats = stats;
+    COUNT_SKIP(jc, jc->offset);
+    return TRUE;
+#else
+    jc->stats = NULL;
+    return stats == NULL;
+#endif
+}
+
+
+void
+JSON_checker_set_error(JSON_checker jc, JSON_error error)
+{
+    jc->error = error;
+}
+
+
+void
+JSON_error_locate(JSON_error error, const char* text, size_t length)
+{
+/*
+    Count the linefeeds before the offset. This is only done after an error,
+    so the checker itself never has to track lines.
+*/
+    size_t end = (error->offset < length)
+        ? error->offset
+        : length;
+    const char* line_start = text;
+    const char* newline;
+    size_t line = 1;
+
+    for (;;) {
+        newline = (const char*)memchr(
+            line_start,
+            '\n',
+            end - (size_t)(line_start - text)
+        );
+        if (newline == NULL) {
+            break;
+        }
+        line += 1;
+        line_start = newline + 1;
+    }
+    error->line = line;
+    error->column = error->offset - (size_t)(line_start - text) + 1;
+}
+
+
+void
+JSON_checker_release(JSON_checker jc)
+{
+/*
+    Free the heap stack that a deep text may have caused a JSON_checker made
+    by init_JSON_checker to acquire, the buffer that gathers tokens for a
+    handler, and the cursor of a select, which is let go. The JSON_checker can
+    still be reset and used afterward.
+*/
+    if (jc->stack != jc->inline_stack) {
+        free((void*)jc->stack);
+        jc->size = JSON_CHECKER_INLINE_WORDS * LEVELS_PER_WORD;
+        jc->stack = jc->inline_stack;
+    }
+    free((void*)jc->spill);
+    jc->spill = NULL;
+    jc->spill_size = 0;
+    jc->spill_length = 0;
+    free((void*)jc->cursor);
+    jc->cursor = NULL;
+    jc->select = NULL;
+}
+
+
+/*
+    The actions. Each is called when the state transition table produces the
+    corresponding negative number. Each returns false if the action is not
+    valid in the current mode.
+*/
+
+static int
+act_error(JSON_checker jc)
+{
+    (void)jc;
+    return FALSE;
+}
+
+
+static int
+act_colon(JSON_checker jc)
+{
+/*
+    A colon causes a flip from key mode to object mode.
+*/
+    if (!pop(jc, MODE_KEY) || !push(jc, MODE_OBJECT)) {
+        return FALSE;
+    }
+    jc->state = VA;
+    return TRUE;
+}
+
+
+static int
+act_comma(JSON_checker jc)
+{
+    switch (top_mode(jc)) {
+    case MODE_OBJECT:
+/*
+    A comma causes a flip from object mode to key mode.
+*/
+        if (!pop(jc, MODE_OBJECT) || !push(jc, MODE_KEY)) {
+            return FALSE;
+        }
+        jc->state = KE;
+        return TRUE;
+    case MODE_ARRAY:
+        jc->state = VA;
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+
+static int
+act_quote(JSON_checker jc)
+{
+    switch (top_mode(jc)) {
+    case MODE_KEY:
+        jc->state = CO;
+        return TRUE;
+    case MODE_ARRAY:
+    case MODE_OBJECT:
+        jc->state = OK;
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+
+static int
+act_begin_array(JSON_checker jc)
+{
+    if (!push(jc, MODE_ARRAY)) {
+        return FALSE;
+    }
+    jc->state = AR;
+    return TRUE;
+}
+
+
+static int
+act_begin_object(JSON_checker jc)
+{
+    if (!push(jc, MODE_KEY)) {
+        return FALSE;
+    }
+    jc->state = OB;
+    return TRUE;
+}
+
+
+static int
+act_end_array(JSON_checker jc)
+{
+    if (!pop(jc, MODE_ARRAY)) {
+        return FALSE;
+    }
+    jc->state = OK;
+    return TRUE;
+}
+
+
+static int
+act_end_object(JSON_checker jc)
+{
+    if (!pop(jc, MODE_OBJECT)) {
+        return FALSE;
+    }
+    jc->state = OK;
+    return TRUE;
+}
+
+
+static int
+act_end_empty_object(JSON_checker jc)
+{
+    if (!pop(jc, MODE_KEY)) {
+        return FALSE;
+    }
+    jc->state = OK;
+    return TRUE;
+}
+
+
+static int (*const actions[9])(JSON_checker jc) = {
+/*
+    The actions are indexed by 255 minus the value in the state transition
+    table, so the universal error code -1 selects act_error.
+*/
+    act_error,              /* __ */
+    act_colon,              /* -2 : */
+    act_comma,              /* -3 , */
+    act_quote,              /* -4 " */
+    act_begin_array,        /* -5 [ */
+    act_begin_object,       /* -6 { */
+    act_end_array,          /* -7 ] */
+    act_end_object,         /* -8 } */
+    act_end_empty_object    /* -9 empty } */
+};
+
+
+int
+JSON_checker_char(JSON_checker jc, int next_char)
+{
+/*
+    After calling new_JSON_checker, call this function for each character (or
+    partial character) in your JSON text. It can accept UTF-8, UTF-16, or
+    UTF-32. It returns TRUE if things are looking ok so far. If it rejects the
+    text, it destroys the JSON_checker object and returns false.
+*/
+    int next_class, next_state;
+/*
+    Determine the character's class.
+*/
+    if (jc->valid != GOOD) {
+        return FALSE;
+    }
+    if (next_char < 0) {
+        return fail(jc, jc->offset, next_char);
+    }
+    if (jc->handler != NULL || jc->select != NULL || jc->minify != NULL) {
+        unsigned char byte = (unsigned char)next_char;
+        if (next_char >= 256) {
+            return fail(jc, jc->offset, next_char);
+        }
+        return JSON_checker_buffer(jc, (const char*)&byte, 1);
+    }
+    if (jc->options & JSON_CHECKER_UTF8) {
+        if (next_char >= 256 || !utf8_step(&jc->utf8, next_char)) {
+            return fail(jc, jc->offset, next_char);
+        }
+    }
+    next_class = (next_char < 256)
+        ? byte_class[next_char]
+        : C_ETC;
+/*
+    Get the next state from the state transition table.
+*/
+    next_state = state_transition_table[jc->state][next_class];
+    COUNT_BYTE(jc, jc->offset, jc->state, next_state, next_class);
+/*
+    If the structure is being recorded, note the actions other than the closing
+    quote, and the transitions that begin a value.
+*/
+    if (jc->index != NULL && (
+        (next_state < NR_STATES)
+            ? jc->state <= AR && next_state > AR
+            : next_state != 252 && next_state != 255
+    ) && !index_add(jc->index, jc->offset)) {
+        return fail(jc, jc->offset, next_char);
+    }
+    if (next_state < NR_STATES) {
+/*
+    Change the state.
+*/
+        jc->state = next_state;
+/*
+    Or perform one of the actions.
+*/
+    } else if (!actions[255 - next_state](jc)) {
+        return fail(jc, jc->offset, next_char);
+    }
+    jc->offset += 1;
+    return TRUE;
+}
+
+
+static int
+event(int (*callback)(void* context), void* context)
+{
+    return callback == NULL || callback(context);
+}
+
+
+static int
+spill_add(JSON_checker jc, const unsigned char* p, size_t length)
+{
+/*
+    Append part of a token to the spill buffer, which gathers a token that
+    spans buffers. Return false if memory runs out.
+*/
+    size_t size;
+    char* bigger;
+
+    if (length == 0) {
+        return TRUE;
+    }
+    if (jc->spill_length + length > jc->spill_size) {
+        size = (jc->spill_size > 0) ? jc->spill_size * 2 : 256;
+        while (size < jc->spill_length + length) {
+            size *= 2;
+        }
+        bigger = (char*)realloc(jc->spill, size);
+        if (bigger == NULL) {
+            return FALSE;
+        }
+        jc->spill = bigger;
+        jc->spill_size = size;
+    }
+    memcpy(jc->spill + jc->spill_length, p, length);
+    jc->spill_length += length;
+    return TRUE;
+}
+
+
+static int
+deliver(
+    JSON_checker jc,
+    int (*callback)(void* context, const char* p, size_t length),
+    const unsigned char* token,
+    const unsigned char* end
+)
+{
+/*
+    Give a key, string, or number that ends at end to its callback. If the
+    beginning of the token was spilled from an earlier buffer, the rest is
+    added to the spill, and the whole token is given from there. Otherwise the
+    slice points into the caller's buffer.
+*/
+    size_t length;
+
+    if (jc->spill_length > 0) {
+        if (!spill_add(jc, token, (size_t)(end - token))) {
+            return FALSE;
+        }
+        length = jc->spill_length;
+        jc->spill_length = 0;
+        return callback == NULL ||
+                callback(jc->handler->context, jc->spill, length);
+    }
+    return callback == NULL || callback(
+        jc->handler->context,
+        (const char*)token,
+        (size_t)(end - token)
+    );
+}
+
+
+static int
+handle_buffer(
+    JSON_checker jc,
+    const unsigned char* start,
+    const unsigned char* end
+)
+{
+/*
+    handle_buffer is JSON_checker_buffer for a JSON_checker with a handler. It
+    runs the same machine, and also watches the transitions for the beginning
+    and end of each token, so that it can deliver the events.
+
+    token points to the first byte of the content of the current key, string,
+    or number. A token that is still open at the end of the buffer is moved to
+    the spill, and continues from the start of the next buffer.
+*/
+    const unsigned char* next = start;
+    const unsigned char* token = start;
+    JSON_handler handler = jc->handler;
+    JSON_index index = jc->index;
+    int strict = jc->options & JSON_CHECKER_UTF8;
+    int next_state;
+    int state;
+    int ok;
+
+    state = jc->state;
+    while (next < end) {
+        if (state == ST) {
+            if (strict) {
+                const unsigned char* from = next;
+                int utf8 = jc->utf8;
+                next = scan_strict_string(&jc->utf8, next, end);
+                if (next == NULL) {
+                    next = find_bad_utf8(utf8, from);
+                    jc->state = state;
+                    return fail(jc, jc->offset + (size_t)(next - start), *next);
+                }
+            } else {
+                next = scan_string(next, end, 0);
+            }
+            if (next == end) {
+                break;
+            }
+        } else if (*next <= ' ' && state <= AR) {
+            next = skip_white(next, end);
+            if (next == end) {
+                break;
+            }
+        }
+        next_state = state_transition_table[state][byte_class[*next]];
+        COUNT_BYTE(jc, jc->offset + (size_t)(next - start), state, next_state,
+                byte_class[*next]);
+        jc->state = state;
+        if (next_state == 255) {
+            return fail(jc, jc->offset + (size_t)(next - start), *next);
+        }
+        if (index != NULL && (
+            (next_state < NR_STATES)
+                ? state <= AR && next_state > AR
+                : next_state != 252
+        ) && !index_add(index, jc->offset + (size_t)(next - start))) {
+            return fail(jc, jc->offset + (size_t)(next - start), *next);
+        }
+        if (next_state < NR_STATES) {
+/*
+    A transition out of the states between tokens begins a value. A number ends
+    with the whitespace that follows it, and a literal with its last letter.
+*/
+            if (state <= AR && next_state > AR) {
+                token = (next_state == ST)
+                    ? next + 1
+                    : next;
+                ok = TRUE;
+            } else if (next_state == OK && state >= MI && state <= E3) {
+                ok = deliver(jc, handler->number, token, next);
+            } else if (next_state == OK && state == T3) {
+                ok = handler->boolean == NULL ||
+                        handler->boolean(handler->context, TRUE);
+            } else if (next_state == OK && state == F4) {
+                ok = handler->boolean == NULL ||
+                        handler->boolean(handler->context, FALSE);
+            } else if (next_state == OK && state == N3) {
+                ok = event(handler->null, handler->context);
+            } else {
+                ok = TRUE;
+            }
+            if (!ok) {
+                return fail(jc, jc->offset + (size_t)(next - start), *next);
+            }
+            state = next_state;
+        } else {
+/*
+    A number can also be ended by an action. The only action inside of a
+    string is the closing quote.
+*/
+            if (state > ST && !deliver(jc, handler->number, token, next)) {
+                return fail(jc, jc->offset + (size_t)(next - start), *next);
+            }
+            if (!actions[255 - next_state](jc)) {
+                return fail(jc, jc->offset + (size_t)(next - start), *next);
+            }
+            switch (next_state) {
+            case 252:
+                ok = deliver(
+                    jc,
+                    (jc->state == CO)
+                        ? handler->key
+                        : handler->string,
+                    token,
+                    next
+                );
+                break;
+            case 251:
+                ok = event(handler->begin_array, handler->context);
+                break;
+            case 250:
+                ok = event(handler->begin_object, handler->context);
+                break;
+            case 249:
+                ok = event(handler->end_array, handler->context);
+                break;
+            case 248:
+            case 247:
+                ok = event(handler->end_object, handler->context);
+                break;
+            default:
+                ok = TRUE;
+            }
+            if (!ok) {
+                return fail(jc, jc->offset + (size_t)(next - start), *next);
+            }
+            state = jc->state;
+        }
+        next += 1;
+    }
+    jc->state = state;
+    if (state >= ST && state <= E3 &&
+            !spill_add(jc, token, (size_t)(end - token))) {
+        return fail(jc, jc->offset + (size_t)(end - start), -1);
+    }
+    jc->offset += (size_t)(end - start);
+    return TRUE;
+}
+
+
+static int
+trailing_zeros(uint64_t w)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#else
+    int n = 0;
+    while ((w & 1) == 0) {
+        w >>= 1;
+        n += 1;
+    }
+    return n;
+#endif
+}
+
+
+static int
+count_ones(uint64_t w)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(w);
+#else
+    int n = 0;
+    while (w != 0) {
+        w &= w - 1;
+        n += 1;
+    }
+    return n;
+#endif
+}
+
+
+static const char*
+pointer_token(const char* pointer, int level, size_t* length)
+{
+/*
+    Find the token of a pointer that names a member or element of the
+    container at level, which is token level - 1 counting from 0.
+*/
+    const char* token;
+    while (level > 0) {
+        pointer = strchr(pointer, '/') + 1;
+        level -= 1;
+    }
+    token = pointer;
+    while (*pointer != 0 && *pointer != '/') {
+        pointer += 1;
+    }
+    *length = (size_t)(pointer - token);
+    return token;
+}
+
+
+static int
+hex_value(int c)
+{
+    return (c <= '9')
+        ? c - '0'
+        : (c | 0x20) - 'a' + 10;
+}
+
+
+static size_t
+key_char(const char* key, size_t length, size_t* at, char utf8[4])
+{
+/*
+    Decode the next character of a key, which is JSON text with its escapes,
+    into UTF-8. Return the number of bytes in utf8. A surrogate that is not
+    one of a pair becomes U+FFFD, as in JSON_tape.
+*/
+    unsigned long c;
+    unsigned long low;
+    size_t i = *at;
+
+    if (key[i] != '\\') {
+        utf8[0] = key[i];
+        *at = i + 1;
+        return 1;
+    }
+    switch (key[i + 1]) {
+    case 'b':
+        c = '\b';
+        break;
+    case 'f':
+        c = '\f';
+        break;
+    case 'n':
+        c = '\n';
+        break;
+    case 'r':
+        c = '\r';
+        break;
+    case 't':
+        c = '\t';
+        break;
+    case 'u':
+        c = (unsigned long)(hex_value(key[i + 2]) << 12 |
+                hex_value(key[i + 3]) << 8 | hex_value(key[i + 4]) << 4 |
+                hex_value(key[i + 5]));
+        i += 4;
+        if (c >= 0xD800 && c < 0xDC00 && i + 8 <= length &&
+                key[i + 2] == '\\' && key[i + 3] == 'u') {
+            low = (unsigned long)(hex_value(key[i + 4]) << 12 |
+                    hex_value(key[i + 5]) << 8 | hex_value(key[i + 6]) << 4 |
+                    hex_value(key[i + 7]));
+            if (low >= 0xDC00 && low < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            }
+        }
+        if (c >= 0xD800 && c < 0xE000) {
+            c = 0xFFFD;
+        }
+        break;
+    default:
+        c = (unsigned char)key[i + 1];
+    }
+    *at = i + 2;
+    if (c < 0x80) {
+        utf8[0] = (char)c;
+        return 1;
+    }
+    if (c < 0x800) {
+        utf8[0] = (char)(0xC0 | c >> 6);
+        utf8[1] = (char)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        utf8[0] = (char)(0xE0 | c >> 12);
+        utf8[1] = (char)(0x80 | (c >> 6 & 0x3F));
+        utf8[2] = (char)(0x80 | (c & 0x3F));
+        return 3;
+    }
+    utf8[0] = (char)(0xF0 | c >> 18);
+    utf8[1] = (char)(0x80 | (c >> 12 & 0x3F));
+    utf8[2] = (char)(0x80 | (c >> 6 & 0x3F));
+    utf8[3] = (char)(0x80 | (c & 0x3F));
+    return 4;
+}
+
+
+static int
+key_matches(const char* key, size_t length, const char* token, size_t size)
+{
+/*
+    Compare a key, with its JSON escapes, to a pointer token, with its ~0 and
+    ~1 escapes. Most keys and tokens have no escapes, and are just compared.
+*/
+    char utf8[4];
+    size_t at = 0;
+    size_t i = 0;
+    size_t n, k;
+
+    if (memchr(key, '\\', length) == NULL && memchr(token, '~', size) == NULL) {
+        return length == size && memcmp(key, token, length) == 0;
+    }
+    while (at < length) {
+        n = key_char(key, length, &at, utf8);
+        for (k = 0; k < n; k += 1) {
+            if (i >= size) {
+                return FALSE;
+            }
+            if (token[i] == '~') {
+                if (i + 1 >= size ||
+                        utf8[k] != ((token[i + 1] == '1') ? '/' : '~')) {
+                    return FALSE;
+                }
+                i += 2;
+            } else {
+                if (utf8[k] != token[i]) {
+                    return FALSE;
+                }
+                i += 1;
+            }
+        }
+    }
+    return i == size;
+}
+
+
+static int
+index_matches(size_t index, const char* token, size_t size)
+{
+/*
+    Compare an array index to a pointer token, which must be 0 or a number
+    without leading zeros. The token "-" names no element.
+*/
+    size_t value = 0;
+    size_t i;
+
+    if (size == 0 || (token[0] == '0' && size > 1)) {
+        return FALSE;
+    }
+    for (i = 0; i < size; i += 1) {
+        if (token[i] < '0' || token[i] > '9') {
+            return FALSE;
+        }
+        value = value * 10 + (size_t)(token[i] - '0');
+    }
+    return value == index;
+}
+
+
+static uint64_t
+select_key(JSON_checker jc, const char* key, size_t length)
+{
+/*
+    Return the pointers that go through the container at the top of the stack
+    and then through this key.
+*/
+    struct JSON_select_cursor* cursor = jc->cursor;
+    uint64_t live = cursor->live[jc->top];
+    uint64_t result = 0;
+    const char* token;
+    size_t size;
+    int i;
+
+    while (live != 0) {
+        i = trailing_zeros(live);
+        live &= live - 1;
+        token = pointer_token(jc->select->pointers[i], jc->top, &size);
+        if (key_matches(key, length, token, size)) {
+            result |= (uint64_t)1 << i;
+        }
+    }
+    return result;
+}
+
+
+static uint64_t
+select_value(JSON_checker jc, size_t offset, uint64_t* named)
+{
+/*
+    A value begins at offset. Return the pointers that go through it or to it.
+    Begin the ranges of those that name it, unless they have already been
+    found, and set named to them.
+*/
+    struct JSON_select_cursor* cursor = jc->cursor;
+    uint64_t result;
+    uint64_t live;
+    const char* token;
+    size_t size;
+    int i;
+
+    if (jc->top == 0) {
+        result = cursor->all;
+    } else if (top_mode(jc) == MODE_ARRAY) {
+        live = cursor->live[jc->top];
+        result = 0;
+        while (live != 0) {
+            i = trailing_zeros(live);
+            live &= live - 1;
+            token = pointer_token(jc->select->pointers[i], jc->top, &size);
+            if (index_matches(cursor->count[jc->top], token, size)) {
+                result |= (uint64_t)1 << i;
+            }
+        }
+        cursor->count[jc->top] += 1;
+    } else {
+        result = cursor->next;
+        cursor->next = 0;
+    }
+    *named = result & cursor->ends[jc->top] & ~cursor->started;
+    cursor->started |= *named;
+    live = *named;
+    while (live != 0) {
+        i = trailing_zeros(live);
+        live &= live - 1;
+        jc->select->offsets[i] = offset;
+    }
+    return result;
+}
+
+
+static void
+select_end(JSON_checker jc, uint64_t named, size_t offset)
+{
+/*
+    End the ranges of the values that end just before offset.
+*/
+    int i;
+
+    jc->cursor->found |= named;
+    while (named != 0) {
+        i = trailing_zeros(named);
+        named &= named - 1;
+        jc->select->lengths[i] = offset - jc->select->offsets[i];
+    }
+}
+
+
+static const unsigned char*
+pass_over(struct JSON_select_cursor* cursor, const unsigned char* next,
+        const unsigned char* end)
+{
+/*
+    Pass over the brackets of a subtree, and any strings in it, without
+    checking them. Return a pointer to the byte after the bracket that closes
+    it, or end if it is still open.
+
+    The bytes are taken 64 at a time as masks from structure_block. A quote
+    that follows an odd run of backslashes is escaped. The mask of the bytes
+    inside of strings is the running XOR of the other quotes, so brackets in
+    strings can be dropped without looking at the bytes one at a time. If a
+    block has fewer closing brackets than are open, the subtree can not end in
+    it, and the brackets are just counted. The last few bytes are copied into
+    a block of spaces. in_string and escape carry from block to block, and
+    from buffer to buffer.
+*/
+    struct structure_masks m;
+    unsigned char tail[64];
+    uint64_t escaped, backslash, inside, open, close, brackets, bit;
+    size_t n;
+    int carry, i;
+
+    while (next < end) {
+        n = (size_t)(end - next);
+        if (n >= 64) {
+            n = 64;
+            structure_block(next, &m);
+        } else {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, next, n);
+            structure_block(tail, &m);
+        }
+        escaped = (uint64_t)cursor->escape;
+        carry = FALSE;
+        backslash = m.backslash;
+        while (backslash != 0) {
+            i = trailing_zeros(backslash);
+            backslash &= backslash - 1;
+            if ((escaped >> i & 1) == 0) {
+                if (i == 63) {
+                    carry = TRUE;
+                } else {
+                    escaped |= (uint64_t)2 << i;
+                }
+            }
+        }
+        inside = m.quote & ~escaped;
+        inside ^= inside << 1;
+        inside ^= inside << 2;
+        inside ^= inside << 4;
+        inside ^= inside << 8;
+        inside ^= inside << 16;
+        inside ^= inside << 32;
+        if (cursor->in_string) {
+            inside = ~inside;
+        }
+        open = m.open & ~inside;
+        close = m.close & ~inside;
+        if (count_ones(close) < cursor->skip) {
+            cursor->skip += count_ones(open) - count_ones(close);
+        } else {
+            brackets = open | close;
+            while (brackets != 0) {
+                i = trailing_zeros(brackets);
+                bit = (uint64_t)1 << i;
+                brackets &= brackets - 1;
+                cursor->skip += (open & bit) ? 1 : -1;
+                if (cursor->skip == 0) {
+                    cursor->in_string = FALSE;
+                    cursor->escape = FALSE;
+                    return next + i + 1;
+                }
+            }
+        }
+        cursor->in_string = (int)(inside >> (n - 1) & 1);
+        cursor->escape = (n == 64)
+            ? carry
+            : (int)(escaped >> n & 1);
+        next += n;
+    }
+    return end;
+}
+
+
+static int
+select_buffer(
+    JSON_checker jc,
+    const unsigned char* start,
+    const unsigned char* end
+)
+{
+/*
+    select_buffer is JSON_checker_buffer for a JSON_checker with a select. It
+    runs the same machine as handle_buffer, watching for the beginning and end
+    of each value, and keeps the cursor in step with the stack. A container
+    that no pointer reaches into is given to pass_over instead of to the
+    machine. It is left in the state it had before the container, and the
+    stack is not pushed, until pass_over finds the end.
+
+    token points to the first byte of the content of the current key. A key
+    that is still open at the end of the buffer is moved to the spill.
+*/
+    struct JSON_select_cursor* cursor = jc->cursor;
+    const unsigned char* next = start;
+    const unsigned char* token = start;
+    int strict = jc->options & JSON_CHECKER_UTF8;
+    uint64_t reach;
+    uint64_t named;
+    size_t at;
+    int next_state;
+    int state;
+
+    state = jc->state;
+    while (next < end) {
+        if (cursor->skip > 0) {
+            next = pass_over(cursor, next, end);
+            if (cursor->skip > 0) {
+                break;
+            }
+            at = jc->offset + (size_t)(next - start);
+            COUNT_SKIP(jc, at);
+            select_end(jc, cursor->skip_matched, at);
+            jc->top -= cursor->skip_levels;
+            state = OK;
+            continue;
+        }
+/*
+    Once every value has been found, the rest of the text is passed over.
+*/
+        if (cursor->found == cursor->all && state <= AR && jc->top > 0) {
+            cursor->skip = jc->top;
+            cursor->skip_levels = jc->top;
+            cursor->skip_matched = 0;
+            continue;
+        }
+        if (state == ST) {
+            if (strict) {
+                const unsigned char* from = next;
+                int utf8 = jc->utf8;
+                next = scan_strict_string(&jc->utf8, next, end);
+                if (next == NULL) {
+                    next = find_bad_utf8(utf8, from);
+                    jc->state = state;
+                    return fail(jc, jc->offset + (size_t)(next - start), *next);
+                }
+            } else {
+                next = scan_string(next, end, 0);
+            }
+            if (next == end) {
+                break;
+            }
+        } else if (*next <= ' ' && state <= AR) {
+            next = skip_white(next, end);
+            if (next == end) {
+                break;
+            }
+        }
+        at = jc->offset + (size_t)(next - start);
+        next_state = state_transition_table[state][byte_class[*next]];
+        COUNT_BYTE(jc, at, state, next_state, byte_class[*next]);
+        jc->state = state;
+        if (next_state == 255) {
+            return fail(jc, at, *next);
+        }
+        if (next_state < NR_STATES) {
+/*
+    A quote in the OB or KE state begins a key. Any other transition out of
+    the states between tokens begins a scalar value. A number ends with the
+    whitespace that follows it, and a literal with its last letter.
+*/
+            if (state <= AR && next_state > AR) {
+                if (state == OB || state == KE) {
+                    token = next + 1;
+                    cursor->in_key = TRUE;
+                } else {
+                    select_value(jc, at, &cursor->scalar);
+                }
+            } else if (next_state == OK && state >= MI && state <= E3) {
+                select_end(jc, cursor->scalar, at);
+                cursor->scalar = 0;
+            } else if (next_state == OK &&
+                    (state == T3 || state == F4 || state == N3)) {
+                select_end(jc, cursor->scalar, at + 1);
+                cursor->scalar = 0;
+            }
+            state = next_state;
+        } else {
+/*
+    A number can also be ended by an action.
+*/
+            if (state > ST) {
+                select_end(jc, cursor->scalar, at);
+                cursor->scalar = 0;
+            }
+/*
+    A container begins. If no pointer reaches into it, it is passed over.
+*/
+            if (next_state == 251 || next_state == 250) {
+                reach = select_value(jc, at, &named);
+                reach &= ~cursor->ends[jc->top];
+                if (reach == 0) {
+                    cursor->skip = 1;
+                    cursor->skip_levels = 0;
+                    cursor->skip_matched = named;
+                    next += 1;
+                    continue;
+                }
+                if (!actions[255 - next_state](jc)) {
+                    return fail(jc, at, *next);
+                }
+                cursor->live[jc->top] = reach;
+                cursor->matched[jc->top] = named;
+                cursor->count[jc->top] = 0;
+            } else {
+                if (!actions[255 - next_state](jc)) {
+                    return fail(jc, at, *next);
+                }
+                if (next_state == 252) {
+                    if (jc->state == CO) {
+                        cursor->in_key = FALSE;
+                        if (jc->spill_length > 0) {
+                            if (!spill_add(jc, token, (size_t)(next - token))) {
+                                return fail(jc, at, *next);
+                            }
+                            cursor->next = select_key(jc, jc->spill,
+                                    jc->spill_length);
+                            jc->spill_length = 0;
+                        } else {
+                            cursor->next = select_key(jc, (const char*)token,
+                                    (size_t)(next - token));
+                        }
+                    } else {
+                        select_end(jc, cursor->scalar, at + 1);
+                        cursor->scalar = 0;
+                    }
+                } else if (next_state >= 247 && next_state <= 249) {
+                    select_end(jc, cursor->matched[jc->top + 1], at + 1);
+                }
+            }
+            state = jc->state;
+        }
+        next += 1;
+    }
+    jc->state = state;
+    if (cursor->in_key && !spill_add(jc, token, (size_t)(end - token))) {
+        return fail(jc, jc->offset + (size_t)(end - start), -1);
+    }
+    jc->offset += (size_t)(end - start);
+    return TRUE;
+}
+
+
+static int
+minify_grow(JSON_minify minify, size_t length)
+{
+/*
+    Make room in minify for length more bytes, and the 16 that compact may
+    store beyond them. Return false if memory runs out.
+*/
+    size_t capacity;
+    char* bytes;
+
+    if (minify->length + length + 16 <= minify->capacity) {
+        return TRUE;
+    }
+    capacity = (minify->capacity > 0) ? minify->capacity * 2 : 4096;
+    while (capacity < minify->length + length + 16) {
+        capacity *= 2;
+    }
+    bytes = (char*)realloc(minify->bytes, capacity);
+    if (bytes == NULL) {
+        return FALSE;
+    }
+    minify->bytes = bytes;
+    minify->capacity = capacity;
+    return TRUE;
+}
+
+
+static uint64_t
+span_bits(size_t from, size_t to)
+{
+/*
+    The bits from from up to, but not including, to. to is at most 64.
+*/
+    return (to - from == 64)
+        ? ~(uint64_t)0
+        : (((uint64_t)1 << (to - from)) - 1) << from;
+}
+
+
+static unsigned char*
+minify_part(
+    unsigned char* out,
+    const unsigned char* block,
+    const unsigned char* stop,
+    uint64_t drop
+)
+{
+/*
+    Write the bytes of a block that come before stop, leaving out those marked
+    in drop. They are copied into a block of spaces first, so that compact
+    never reads past stop.
+*/
+    unsigned char tail[64];
+
+    memset(tail, ' ', sizeof(tail));
+    memcpy(tail, block, (size_t)(stop - block));
+    drop |= ~span_bits(0, (size_t)(stop - block));
+    return compact(out, tail, ~drop);
+}
+
+
+static int
+minify_buffer(
+    JSON_checker jc,
+    const unsigned char* start,
+    const unsigned char* end
+)
+{
+/*
+    minify_buffer is JSON_checker_buffer for a JSON_checker with a minify. It
+    runs the same machine over blocks of 64 bytes. The whitespace that the
+    machine passes outside of strings, whether in a run between tokens or as
+    the end of a number, is marked in drop. When the block has been checked,
+    compact writes the rest of it while it is still in the cache. If the text
+    is rejected, the part of the block before the error is still written.
+*/
+    const unsigned char* next = start;
+    const unsigned char* block;
+    const unsigned char* stop;
+    const unsigned char* from;
+    JSON_minify minify = jc->minify;
+    JSON_index index = jc->index;
+    int strict = jc->options & JSON_CHECKER_UTF8;
+    unsigned char* base;
+    unsigned char* out;
+    uint64_t drop;
+    int next_state;
+    int state;
+
+    if (!minify_grow(minify, (size_t)(end - start))) {
+        return fail(jc, jc->offset, NO_MEMORY);
+    }
+    base = (unsigned char*)minify->bytes;
+    out = base + minify->length;
+    state = jc->state;
+    while (next < end) {
+        block = next;
+        stop = (end - next >= 64)
+            ? next + 64
+            : end;
+        drop = 0;
+        while (next < stop) {
+            if (state == ST) {
+                if (strict) {
+                    int utf8 = jc->utf8;
+                    from = next;
+                    next = scan_strict_string(&jc->utf8, next, stop);
+                    if (next == NULL) {
+                        next = find_bad_utf8(utf8, from);
+                        jc->state = state;
+                        out = minify_part(out, block, next, drop);
+                        minify->length = (size_t)(out - base);
+                        return fail(jc, jc->offset + (size_t)(next - start), *next);
+                    }
+                } else {
+                    next = scan_string(next, stop, 0);
+                }
+                if (next == stop) {
+                    break;
+                }
+            } else if (*next <= ' ' && state <= AR) {
+                from = next;
+                next = skip_white(next, stop);
+                drop |= span_bits(
+                    (size_t)(from - block),
+                    (size_t)(next - block)
+                );
+                if (next == stop) {
+                    break;
+                }
+            }
+            next_state = state_transition_table[state][byte_class[*next]];
+            COUNT_BYTE(jc, jc->offset + (size_t)(next - start), state,
+                    next_state, byte_class[*next]);
+            if (next_state == 255 || (UNLIKELY(index != NULL) && (
+                (next_state < NR_STATES)
+                    ? state <= AR && next_state > AR
+                    : next_state != 252
+            ) && !index_add(index, jc->offset + (size_t)(next - start)))) {
+                jc->state = state;
+                out = minify_part(out, block, next, drop);
+                minify->length = (size_t)(out - base);
+                return fail(jc, jc->offset + (size_t)(next - start), *next);
+            }
+            if (next_state < NR_STATES) {
+/*
+    Whitespace that the machine accepts outside of a string ends a number.
+*/
+                if (*next <= ' ' && state > ST) {
+                    drop |= (uint64_t)1 << (next - block);
+                }
+                state = next_state;
+            } else {
+                jc->state = state;
+                if (!actions[255 - next_state](jc)) {
+                    out = minify_part(out, block, next, drop);
+                    minify->length = (size_t)(out - base);
+                    return fail(jc, jc->offset + (size_t)(next - start), *next);
+                }
+                state = jc->state;
+            }
+            next += 1;
+        }
+        out = (stop - block == 64)
+            ? compact(out, block, ~drop)
+            : minify_part(out, block, stop, drop);
+    }
+    jc->state = state;
+    minify->length = (size_t)(out - base);
+    jc->offset += (size_t)(end - start);
+    return TRUE;
+}
+
+
+static int
+check_bytes(
+    JSON_checker jc,
+    const unsigned char* start,
+    const unsigned char* end,
+    int strict
+)
+{
+/*
+    check_bytes runs the machine over the bytes from start to end, skipping
+    strings and whitespace with the kernels. strict is true if multibyte
+    sequences are to be checked as UTF-8. It is the body of
+    JSON_checker_buffer, and also takes the code units of UTF-16 and UTF-32
+    once they have been narrowed to bytes.
+*/
+    const unsigned char* next = start;
+    JSON_index index = jc->index;
+    int next_state;
+    int state;
+
+    state = jc->state;
+    while (next < end) {
+/*
+    Inside of a string, every byte other than a quote, a backslash, or a
+    control character leaves the state unchanged, so a run of them can be
+    skipped without consulting the tables.
+
+    In strict UTF-8 mode the multibyte sequences are checked along the way.
+*/
+        if (state == ST) {
+            if (strict) {
+                const unsigned char* from = next;
+                int utf8 = jc->utf8;
+                next = scan_strict_string(&jc->utf8, next, end);
+                if (next == NULL) {
+                    next = find_bad_utf8(utf8, from);
+                    jc->state = state;
+                    return fail(jc, jc->offset + (size_t)(next - start), *next);
+                }
+            } else {
+                next = scan_string(next, end, 0);
+            }
+            if (next == end) {
+                break;
+            }
+/*
+    Between tokens, whitespace leaves the GO, OK, OB, KE, CO, VA, and AR states
+    unchanged, so a run of it can be skipped in the same way.
+*/
+        } else if (*next <= ' ' && state <= AR) {
+            next = skip_white(next, end);
+            if (next == end) {
+                break;
+            }
+        }
+        next_state = state_transition_table[state][byte_class[*next]];
+        COUNT_BYTE(jc, jc->offset + (size_t)(next - start), state, next_state,
+                byte_class[*next]);
+/*
+    If the structure is being recorded, note the actions other than the closing
+    quote, and the transitions that begin a value. The kernels have skipped
+    over strings and whitespace, so only the bytes of tokens get this far.
+*/
+        if (UNLIKELY(index != NULL) && (
+            (next_state < NR_STATES)
+                ? state <= AR && next_state > AR
+                : next_state != 252 && next_state != 255
+        ) && !index_add(index, jc->offset + (size_t)(next - start))) {
+            jc->state = state;
+            return fail(jc, jc->offset + (size_t)(next - start), *next);
+        }
+        next += 1;
+        if (next_state < NR_STATES) {
+            state = next_state;
+        } else {
+            jc->state = state;
+            if (!actions[255 - next_state](jc)) {
+                return fail(jc, jc->offset + (size_t)(next - 1 - start),
+                        next[-1]);
+            }
+            state = jc->state;
+        }
+    }
+    jc->state = state;
+    jc->offset += (size_t)(end - start);
+    return TRUE;
+}
+
+
+int
+JSON_checker_buffer(JSON_checker jc, const char* p, size_t length)
+{
+/*
+    JSON_checker_buffer has the same effect as calling JSON_checker_char for
+    each of the length bytes starting at p, but without the cost of a call per
+    byte. It can be called repeatedly on consecutive pieces of a UTF-8 text.
+    It returns TRUE if things are looking ok so far. If it rejects the text,
+    it destroys the JSON_checker object and returns false.
+*/
+    const unsigned char* start = (const unsigned char*)p;
+    const unsigned char* end = start + length;
+
+    if (jc->valid != GOOD) {
+        return FALSE;
+    }
+    if (jc->minify != NULL) {
+        return minify_buffer(jc, start, end);
+    }
+    if (jc->select != NULL) {
+        return select_buffer(jc, start, end);
+    }
+    if (jc->handler != NULL) {
+        return handle_buffer(jc, start, end);
+    }
+    return check_bytes(jc, start, end, jc->options & JSON_CHECKER_UTF8);
+}
+
+
+/*
+    UTF-16 and UTF-32
+
+    The machine only looks at ASCII. Every other character is C_ETC, which is
+    only allowed inside of a string, where it leaves the state unchanged. So
+    a text in UTF-16 or UTF-32 can be checked without converting it: each code
+    unit is narrowed to one byte, ASCII to itself and anything else to 0x80,
+    and the bytes are given to check_bytes. Because there is one byte per
+    unit, the offsets come out counting units. The units are narrowed a block
+    at a time, by a kernel while they are ASCII, and one by one otherwise.
+
+    The checks that UTF-8 gets from utf8_step are made here instead, as the
+    units are narrowed: a high surrogate must be followed by a low one, a low
+    surrogate must follow a high one, and a UTF-32 unit must be a scalar
+    value. jc->surrogate is true while a high surrogate waits for its partner,
+    and jc->partial holds the bytes of a unit that was split between calls.
+*/
+
+#define UNIT_BLOCK 1024
+
+
+static unsigned long
+read_unit(const unsigned char* p, int encoding)
+{
+    switch (encoding) {
+    case ENCODING_UTF16LE:
+        return (unsigned long)p[1] << 8 | p[0];
+    case ENCODING_UTF16BE:
+        return (unsigned long)p[0] << 8 | p[1];
+    case ENCODING_UTF32LE:
+        return (unsigned long)p[3] << 24 | (unsigned long)p[2] << 16 |
+                (unsigned long)p[1] << 8 | p[0];
+    default:
+        return (unsigned long)p[0] << 24 | (unsigned long)p[1] << 16 |
+                (unsigned long)p[2] << 8 | p[3];
+    }
+}
+
+
+static int
+unit_character(unsigned long unit)
+{
+/*
+    A code unit as the character of an error, which is an int.
+*/
+    return (unit > 0x7FFFFFFF)
+        ? 0x7FFFFFFF
+        : (int)unit;
+}
+
+
+static int
+check_narrowed(
+    JSON_checker jc,
+    const unsigned char* narrowed,
+    size_t count,
+    const unsigned char* units,
+    int encoding
+)
+{
+/*
+    Give count narrowed units to the machine. If one is rejected, the error
+    record is given the code unit itself rather than the byte that stood in
+    for it. The JSON_checker may be gone by then, so only the record is
+    touched.
+*/
+    JSON_error error = jc->error;
+    size_t base = jc->offset;
+    size_t size = (encoding >= ENCODING_UTF32LE) ? 4 : 2;
+
+    if (check_bytes(jc, narrowed, narrowed + count, FALSE)) {
+        return TRUE;
+    }
+    if (error != NULL && error->character >= 0 && error->offset >= base &&
+            error->offset - base < count) {
+        error->character = unit_character(
+            read_unit(units + (error->offset - base) * size, encoding)
+        );
+    }
+    return FALSE;
+}
+
+
+static int
+check_units(
+    JSON_checker jc,
+    const unsigned char* next,
+    const unsigned char* end,
+    int encoding
+)
+{
+    unsigned char narrowed[UNIT_BLOCK];
+    unsigned char split[4];
+    size_t size = (encoding >= ENCODING_UTF32LE) ? 4 : 2;
+    int big = encoding == ENCODING_UTF16BE || encoding == ENCODING_UTF32BE;
+    unsigned long unit;
+    size_t units;
+    size_t k;
+
+    if (jc->valid != GOOD) {
+        return FALSE;
+    }
+    if (jc->handler != NULL || jc->select != NULL || jc->minify != NULL) {
+        return fail(jc, jc->offset, -1);
+    }
+    jc->encoding = encoding;
+/*
+    Finish a code unit that was split between calls. It is copied out first,
+    because a rejection may free the JSON_checker that holds it.
+*/
+    if (jc->partial_length > 0) {
+        while ((size_t)jc->partial_length < size && next < end) {
+            jc->partial[jc->partial_length] = *next;
+            jc->partial_length += 1;
+            next += 1;
+        }
+        if ((size_t)jc->partial_length < size) {
+            return TRUE;
+        }
+        jc->partial_length = 0;
+        memcpy(split, jc->partial, size);
+        if (!check_units(jc, split, split + size, encoding)) {
+            return FALSE;
+        }
+    }
+/*
+    A byte order mark at the very beginning is not part of the text.
+*/
+    if (jc->offset == 0 && (size_t)(end - next) >= size &&
+            read_unit(next, encoding) == 0xFEFF) {
+        next += size;
+        jc->offset = 1;
+        COUNT_SKIP(jc, 1);
+    }
+    while ((size_t)(end - next) >= size) {
+        units = (size_t)(end - next) / size;
+        if (units > UNIT_BLOCK) {
+            units = UNIT_BLOCK;
+        }
+        k = 0;
+        while (k < units) {
+            if (!jc->surrogate) {
+                k += (size == 2)
+                    ? narrow16(narrowed + k, next + k * 2, units - k, big)
+                    : narrow32(narrowed + k, next + k * 4, units - k, big);
+                if (k == units) {
+                    break;
+                }
+            }
+            unit = read_unit(next + k * size, encoding);
+            if ((jc->surrogate)
+                ? unit < 0xDC00 || unit > 0xDFFF
+                : unit > 0x10FFFF || (unit >= 0xD800 && unit <= 0xDFFF &&
+                        (size == 4 || unit >= 0xDC00))) {
+                if (!check_narrowed(jc, narrowed, k, next, encoding)) {
+                    return FALSE;
+                }
+                return fail(jc, jc->offset, unit_character(unit));
+            }
+            jc->surrogate = size == 2 && unit >= 0xD800 && unit <= 0xDBFF;
+            narrowed[k] = (unit < 0x80)
+                ? (unsigned char)unit
+                : 0x80;
+            k += 1;
+        }
+        if (!check_narrowed(jc, narrowed, k, next, encoding)) {
+            return FALSE;
+        }
+        next += k * size;
+    }
+/*
+    Keep the bytes of a code unit that is not finished.
+*/
+    jc->partial_length = (int)(end - next);
+    memcpy(jc->partial, next, (size_t)(end - next));
+    return TRUE;
+}
+
+
+int
+JSON_checker_utf16le(JSON_checker jc, const char* p, size_t length)
+{
+    return check_units(jc, (const unsigned char*)p,
+            (const unsigned char*)p + length, ENCODING_UTF16LE);
+}
+
+
+int
+JSON_checker_utf16be(JSON_checker jc, const char* p, size_t length)
+{
+    return check_units(jc, (const unsigned char*)p,
+            (const unsigned char*)p + length, ENCODING_UTF16BE);
+}
+
+
+int
+JSON_checker_utf32le(JSON_checker jc, const char* p, size_t length)
+{
+    return check_units(jc, (const unsigned char*)p,
+            (const unsigned char*)p + length, ENCODING_UTF32LE);
+}
+
+
+int
+JSON_checker_utf32be(JSON_checker jc, const char* p, size_t length)
+{
+    return check_units(jc, (const unsigned char*)p,
+            (const unsigned char*)p + length, ENCODING_UTF32BE);
+}
+
+
+static int
+detect_encoding(const unsigned char* p, size_t length)
+{
+/*
+    A byte order mark names the encoding. Without one, the first two
+    characters of a JSON text are ASCII, so the zero bytes around them give it
+    away:
+
+        00 00 00 xx     UTF-32BE
+        xx 00 00 00     UTF-32LE
+        00 xx           UTF-16BE
+        xx 00           UTF-16LE
+        xx xx           UTF-8
+*/
+    if (length >= 4 && p[0] == 0x00 && p[1] == 0x00 && p[2] == 0xFE &&
+            p[3] == 0xFF) {
+        return ENCODING_UTF32BE;
+    }
+    if (length >= 4 && p[0] == 0xFF && p[1] == 0xFE && p[2] == 0x00 &&
+            p[3] == 0x00) {
+        return ENCODING_UTF32LE;
+    }
+    if (length >= 2 && p[0] == 0xFE && p[1] == 0xFF) {
+        return ENCODING_UTF16BE;
+    }
+    if (length >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+        return ENCODING_UTF16LE;
+    }
+    if (length >= 4 && p[0] == 0x00 && p[1] == 0x00 && p[2] == 0x00) {
+        return ENCODING_UTF32BE;
+    }
+    if (length >= 4 && p[1] == 0x00 && p[2] == 0x00 && p[3] == 0x00) {
+        return ENCODING_UTF32LE;
+    }
+    if (length >= 2 && p[0] == 0x00) {
+        return ENCODING_UTF16BE;
+    }
+    if (length >= 2 && p[1] == 0x00) {
+        return ENCODING_UTF16LE;
+    }
+    return ENCODING_UTF8;
+}
+
+
+static int
+settle_encoding(JSON_checker jc)
+{
+/*
+    Name the encoding from the bytes held in jc->partial, then pass them
+    along. A UTF-8 byte order mark is skipped. The result is FALSE if the text
+    was rejected, in which case the JSON_checker may have been freed.
+*/
+    unsigned char first[4];
+    const unsigned char* p = first;
+    size_t length = (size_t)jc->partial_length;
+
+    memcpy(first, jc->partial, length);
+    jc->partial_length = 0;
+    jc->encoding = detect_encoding(first, length);
+    if (jc->encoding != ENCODING_UTF8) {
+        return check_units(jc, p, p + length, jc->encoding);
+    }
+    if (length >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+        p += 3;
+        length -= 3;
+        jc->offset = 3;
+        COUNT_SKIP(jc, 3);
+    }
+    return JSON_checker_buffer(jc, (const char*)p, length);
+}
+
+
+int
+JSON_checker_unicode(JSON_checker jc, const char* p, size_t length)
+{
+/*
+    Hold the first four bytes until the encoding can be named, then pass the
+    text along.
+*/
+    const unsigned char* u = (const unsigned char*)p;
+
+    if (jc->valid != GOOD) {
+        return FALSE;
+    }
+    if (jc->encoding == ENCODING_NONE) {
+        while (jc->partial_length < 4 && length > 0) {
+            jc->partial[jc->partial_length] = *u;
+            jc->partial_length += 1;
+            u += 1;
+            length -= 1;
+        }
+        if (jc->partial_length < 4) {
+            return TRUE;
+        }
+        if (!settle_encoding(jc)) {
+            return FALSE;
+        }
+    }
+    return (jc->encoding == ENCODING_UTF8)
+        ? JSON_checker_buffer(jc, (const char*)u, length)
+        : check_units(jc, u, u + length, jc->encoding);
+}
+
+
+int
+JSON_checker_done(JSON_checker jc)
+{
+/*
+    The JSON_checker_done function should be called after all of the characters
+    have been processed, but only if every call to JSON_checker_char returned
+    true. This function deletes the JSON_checker and returns true if the JSON
+    text was accepted. A JSON_checker made by init_JSON_checker is not deleted,
+    and can be reused after calling JSON_checker_reset.
+*/
+    if (jc->valid != GOOD) {
+        return FALSE;
+    }
+    if (jc->encoding == ENCODING_NONE && jc->partial_length > 0 &&
+            !settle_encoding(jc)) {
+        return FALSE;
+    }
+    if (jc->state != OK || jc->partial_length > 0 || !pop(jc, MODE_DONE)) {
+        return fail(jc, jc->offset, -1);
+    }
+    COUNT_REST(jc);
+    if (jc->allocated) {
+        destroy(jc);
+    } else {
+        jc->valid = 0;
+    }
+    return TRUE;
+}
+
+
+/*
+    Checkpoints
+
+    A checkpoint is laid out in bytes, with every number little-endian, so
+    that it can be restored on another machine:
+
+        0   "JSC1"
+        4   the byte counter, in 8 bytes
+        12  the state, the UTF-8 position, the options, and the encoding, in
+            a byte each
+        16  the number of levels on the stack, in 4 bytes
+        20  the length of the spill, in 4 bytes
+        24  the modes, 4 to a byte, the bottom of the stack first
+            the spill
+            an FNV-1a hash of everything before it, in 4 bytes
+*/
+
+#define CHECKPOINT_HEAD 24
+
+
+static void
+put_number(unsigned char* p, uint64_t number, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i += 1) {
+        p[i] = (unsigned char)(number >> (i * 8));
+    }
+}
+
+
+static uint64_t
+get_number(const unsigned char* p, int size)
+{
+    uint64_t number = 0;
+    int i;
+
+    for (i = size - 1; i >= 0; i -= 1) {
+        number = number << 8 | p[i];
+    }
+    return number;
+}
+
+
+static uint32_t
+checkpoint_hash(const unsigned char* p, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < length; i += 1) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+
+size_t
+JSON_checker_save(JSON_checker jc, void* blob, size_t size)
+{
+/*
+    Measure the checkpoint, and write it if it fits.
+*/
+    unsigned char* p = (unsigned char*)blob;
+    size_t levels = (size_t)(jc->top + 1);
+    size_t modes = (levels + 3) / 4;
+    size_t length = CHECKPOINT_HEAD + modes + jc->spill_length + 4;
+    size_t level;
+
+    if (jc->valid != GOOD || jc->select != NULL || jc->surrogate ||
+            jc->partial_length > 0 || jc->spill_length > UINT32_MAX) {
+        return 0;
+    }
+    if (length > size) {
+        return length;
+    }
+    memcpy(p, "JSC1", 4);
+    put_number(p + 4, (uint64_t)jc->offset, 8);
+    p[12] = (unsigned char)jc->state;
+    p[13] = (unsigned char)jc->utf8;
+    p[14] = (unsigned char)jc->options;
+    p[15] = (unsigned char)jc->encoding;
+    put_number(p + 16, (uint64_t)levels, 4);
+    put_number(p + 20, (uint64_t)jc->spill_length, 4);
+    memset(p + CHECKPOINT_HEAD, 0, modes);
+    for (level = 0; level < levels; level += 1) {
+        p[CHECKPOINT_HEAD + level / 4] |= (unsigned char)(
+            (jc->stack[level / LEVELS_PER_WORD] >>
+                    (level % LEVELS_PER_WORD * 2) & 3) << (level % 4 * 2)
+        );
+    }
+    if (jc->spill_length > 0) {
+        memcpy(p + CHECKPOINT_HEAD + modes, jc->spill, jc->spill_length);
+    }
+    put_number(p + length - 4, checkpoint_hash(p, length - 4), 4);
+    return length;
+}
+
+
+int
+JSON_checker_restore(JSON_checker jc, const void* blob, size_t size)
+{
+/*
+    Check everything in the blob before trusting any of it: the hash, the
+    sizes, a state and a UTF-8 position that can occur together, and a stack
+    with MODE_DONE at the bottom and nowhere else. The modes are pushed one
+    at a time, so the stack grows and the depth is enforced as usual.
+*/
+    const unsigned char* p = (const unsigned char*)blob;
+    uint64_t levels, spill_length, modes;
+    size_t level;
+    int mode;
+
+    JSON_checker_reset(jc);
+    if (jc->select != NULL || size < CHECKPOINT_HEAD + 4 ||
+            memcmp(p, "JSC1", 4) != 0 ||
+            get_number(p + size - 4, 4) != checkpoint_hash(p, size - 4)) {
+        return FALSE;
+    }
+    levels = get_number(p + 16, 4);
+    spill_length = get_number(p + 20, 4);
+    modes = (levels + 3) / 4;
+    if (levels < 1 || levels > (uint64_t)jc->depth ||
+            CHECKPOINT_HEAD + modes + spill_length + 4 != size ||
+            get_number(p + 4, 8) > (uint64_t)(size_t)-1 ||
+            p[12] >= NR_STATES || p[13] >= 8 ||
+            (p[13] != 0 && p[12] != ST) ||
+            (p[14] & ~JSON_CHECKER_UTF8) != 0 || p[15] > ENCODING_UTF32BE ||
+            (p[CHECKPOINT_HEAD] & 3) != MODE_DONE) {
+        return FALSE;
+    }
+    for (level = 1; level < (size_t)levels; level += 1) {
+        mode = p[CHECKPOINT_HEAD + level / 4] >> (level % 4 * 2) & 3;
+        if (mode == MODE_DONE || !push(jc, mode)) {
+            JSON_checker_reset(jc);
+            return FALSE;
+        }
+    }
+    if (spill_length > 0 && !spill_add(
+        jc,
+        p + CHECKPOINT_HEAD + modes,
+        (size_t)spill_length
+    )) {
+        JSON_checker_reset(jc);
+        return FALSE;
+    }
+    jc->offset = (size_t)get_number(p + 4, 8);
+    jc->state = p[12];
+    jc->utf8 = p[13];
+    jc->options = p[14];
+    jc->encoding = p[15];
+    COUNT_SKIP(jc, jc->offset);
+    return TRUE;
+}
+
+
+/*
+    Parallel checking
+
+    JSON_checker_parallel checks one large buffer with several threads. The
+    buffer is cut into chunks, and every chunk is checked at the same time,
+    before it is known what state the text will be in where the chunk begins.
+
+    A chunk is checked speculatively by a set of guesses. At first there is a
+    guess for every state the chunk might begin in: inside or outside of a
+    string, after a backslash, in the middle of a literal, and so on. A guess
+    keeps its own stack of the containers that it opens. When it needs to
+    look below that, at containers that were opened before the chunk, it
+    records what it requires of them instead. If a decision depends on a mode
+    it can not see, such as whether a comma separates the elements of an
+    array or the members of an object, the guess splits in two, one for each
+    possibility. A guess that hits an error is dropped. Guesses that have
+    reached the same condition are merged.
+
+    Most guesses die within a few bytes, so each chunk ends with a small
+    summary: for each entry state that survived, the requirements on the
+    outer stack, the number of outer levels it pops, the highest level it
+    reaches, the containers it leaves open, and the state it ends in.
+
+    The summaries are then stitched together in order against the real
+    JSON_checker. For each chunk, the one guess whose entry state and
+    requirements match the real state and stack is applied to it. The depth
+    limit is checked with the highest level. The result is the same as
+    JSON_checker_buffer gives for the same bytes. A chunk whose guesses got
+    out of hand is simply checked again, sequentially, during the stitching.
+*/
+
+#define ALL_MODES ((1 << MODE_ARRAY) | (1 << MODE_DONE) | (1 << MODE_KEY) | \
+        (1 << MODE_OBJECT))
+#define MAX_GUESSES 64
+#define MIN_CHUNK (256 * 1024)
+
+struct guess {
+    uint32_t entries;       /* the entry states that this guess stands for */
+    int state;
+    int utf8;
+    int popped;             /* outer levels popped */
+    int high;               /* highest level reached, relative to the entry */
+    int needs;              /* outer levels that have requirements */
+    int need_size;
+    uint8_t* need;          /* the modes allowed at each outer level */
+    int count;              /* local levels */
+    int size;
+    uint8_t* modes;         /* the local stack */
+};
+
+struct chunk {
+    const unsigned char* start;
+    const unsigned char* end;
+    int options;
+    int abandoned;
+    int nr_guesses;
+    struct guess guesses[MAX_GUESSES];
+};
+
+
+static int
+reserve(uint8_t** array, int* size, int needed)
+{
+/*
+    Make room for needed bytes in a growable array.
+*/
+    int new_size;
+    uint8_t* bigger;
+    if (needed <= *size) {
+        return TRUE;
+    }
+    new_size = (*size > 0) ? *size * 2 : 16;
+    if (new_size < needed) {
+        new_size = needed;
+    }
+    bigger = (uint8_t*)realloc(*array, new_size);
+    if (bigger == NULL) {
+        return FALSE;
+    }
+    *array = bigger;
+    *size = new_size;
+    return TRUE;
+}
+
+
+static void
+drop_guess(struct chunk* c, int i)
+{
+    free(c->guesses[i].need);
+    free(c->guesses[i].modes);
+    c->nr_guesses -= 1;
+    c->guesses[i] = c->guesses[c->nr_guesses];
+}
+
+
+static struct guess*
+split_guess(struct chunk* c, struct guess* g)
+{
+/*
+    Make a copy of a guess so that it can follow the other possibility.
+    Return NULL and abandon the chunk if there are too many guesses.
+*/
+    struct guess* copy;
+    if (c->nr_guesses >= MAX_GUESSES) {
+        c->abandoned = TRUE;
+        return NULL;
+    }
+    copy = &c->guesses[c->nr_guesses];
+    *copy = *g;
+    copy->need = NULL;
+    copy->need_size = 0;
+    copy->modes = NULL;
+    copy->size = 0;
+    if (!reserve(&copy->need, &copy->need_size, g->needs) ||
+            !reserve(&copy->modes, &copy->size, g->count)) {
+        free(copy->need);
+        free(copy->modes);
+        c->abandoned = TRUE;
+        return NULL;
+    }
+    if (g->needs > 0) {
+        memcpy(copy->need, g->need, g->needs);
+    }
+    if (g->count > 0) {
+        memcpy(copy->modes, g->modes, g->count);
+    }
+    c->nr_guesses += 1;
+    return copy;
+}
+
+
+static int
+outer_modes(struct guess* g)
+{
+/*
+    Return the modes still allowed for the first outer level that has not been
+    popped, creating its requirement if there is none yet.
+*/
+    if (g->needs == g->popped) {
+        if (!reserve(&g->need, &g->need_size, g->needs + 1)) {
+            return 0;
+        }
+        g->need[g->needs] = ALL_MODES;
+        g->needs += 1;
+    }
+    return g->need[g->popped];
+}
+
+
+static int
+guess_push(struct guess* g, int mode)
+{
+    if (!reserve(&g->modes, &g->size, g->count + 1)) {
+        return FALSE;
+    }
+    g->modes[g->count] = (uint8_t)mode;
+    g->count += 1;
+    if (g->count - g->popped > g->high) {
+        g->high = g->count - g->popped;
+    }
+    return TRUE;
+}
+
+
+static int
+guess_pop(struct guess* g, int mode)
+{
+    int allowed;
+    if (g->count > 0) {
+        if (g->modes[g->count - 1] != mode) {
+            return FALSE;
+        }
+        g->count -= 1;
+        return TRUE;
+    }
+    allowed = outer_modes(g) & (1 << mode);
+    if (allowed == 0) {
+        return FALSE;
+    }
+    g->need[g->popped] = (uint8_t)allowed;
+    g->popped += 1;
+    return TRUE;
+}
+
+
+static int
+guess_act(struct chunk* c, struct guess* g, int action)
+{
+/*
+    Perform an action for a guess, as the act_ functions do for a real
+    JSON_checker. Return false if the guess dies. If the outcome depends on an
+    unknown outer mode, the guess takes one possibility and a new guess is made
+    for the other.
+*/
+    int allowed;
+    struct guess* other;
+
+    switch (action) {
+/* : */ case 254:
+        if (!guess_pop(g, MODE_KEY) || !guess_push(g, MODE_OBJECT)) {
+            return FALSE;
+        }
+        g->state = VA;
+        return TRUE;
+
+/* , */ case 253:
+        if (g->count > 0) {
+            switch (g->modes[g->count - 1]) {
+            case MODE_OBJECT:
+                g->count -= 1;
+                if (!guess_push(g, MODE_KEY)) {
+                    return FALSE;
+                }
+                g->state = KE;
+                return TRUE;
+            case MODE_ARRAY:
+                g->state = VA;
+                return TRUE;
+            default:
+                return FALSE;
+            }
+        }
+        allowed = outer_modes(g) & ((1 << MODE_OBJECT) | (1 << MODE_ARRAY));
+        if (allowed == ((1 << MODE_OBJECT) | (1 << MODE_ARRAY))) {
+            other = split_guess(c, g);
+            if (other == NULL) {
+                return FALSE;
+            }
+            other->need[other->popped] = 1 << MODE_ARRAY;
+            other->state = VA;
+            allowed = 1 << MODE_OBJECT;
+        }
+        if (allowed == 0) {
+            return FALSE;
+        }
+        g->need[g->popped] = (uint8_t)allowed;
+        if (allowed == (1 << MODE_ARRAY)) {
+            g->state = VA;
+            return TRUE;
+        }
+        g->popped += 1;
+        if (!guess_push(g, MODE_KEY)) {
+            return FALSE;
+        }
+        g->state = KE;
+        return TRUE;
+
+/* " */ case 252:
+        if (g->count > 0) {
+            switch (g->modes[g->count - 1]) {
+            case MODE_KEY:
+                g->state = CO;
+                return TRUE;
+            case MODE_ARRAY:
+            case MODE_OBJECT:
+                g->state = OK;
+                return TRUE;
+            default:
+                return FALSE;
+            }
+        }
+        allowed = outer_modes(g);
+        if ((allowed & (1 << MODE_KEY)) &&
+                (allowed & ((1 << MODE_ARRAY) | (1 << MODE_OBJECT)))) {
+            other = split_guess(c, g);
+            if (other == NULL) {
+                return FALSE;
+            }
+            other->need[other->popped] = (uint8_t)(allowed &
+                    ((1 << MODE_ARRAY) | (1 << MODE_OBJECT)));
+            other->state = OK;
+            allowed = 1 << MODE_KEY;
+        }
+        if (allowed & (1 << MODE_KEY)) {
+            g->need[g->popped] = 1 << MODE_KEY;
+            g->state = CO;
+            return TRUE;
+        }
+        allowed &= (1 << MODE_ARRAY) | (1 << MODE_OBJECT);
+        if (allowed == 0) {
+            return FALSE;
+        }
+        g->need[g->popped] = (uint8_t)allowed;
+        g->state = OK;
+        return TRUE;
+
+/* [ */ case 251:
+        g->state = AR;
+        return guess_push(g, MODE_ARRAY);
+
+/* { */ case 250:
+        g->state = OB;
+        return guess_push(g, MODE_KEY);
+
+/* ] */ case 249:
+        g->state = OK;
+        return guess_pop(g, MODE_ARRAY);
+
+/* } */ case 248:
+        g->state = OK;
+        return guess_pop(g, MODE_OBJECT);
+
+/* empty } */ case 247:
+        g->state = OK;
+        return guess_pop(g, MODE_KEY);
+
+    default:
+        return FALSE;
+    }
+}
+
+
+static int
+run_guess(
+    struct chunk* c,
+    int i,
+    const unsigned char* next,
+    const unsigned char* end
+)
+{
+/*
+    Run guess i from next to end. Return false if it dies. New guesses made
+    along the way begin just after the byte that split them, so they are run
+    separately from there.
+*/
+    struct guess* g = &c->guesses[i];
+    int strict = c->options & JSON_CHECKER_UTF8;
+    int next_state;
+    int before;
+
+    while (next < end) {
+        if (g->state == ST) {
+            if (strict) {
+                next = scan_strict_string(&g->utf8, next, end);
+                if (next == NULL) {
+                    return FALSE;
+                }
+            } else {
+                next = scan_string(next, end, 0);
+            }
+            if (next == end) {
+                break;
+            }
+        } else if (*next <= ' ' && g->state <= AR) {
+            next = skip_white(next, end);
+            if (next == end) {
+                break;
+            }
+        }
+        next_state = state_transition_table[g->state][byte_class[*next]];
+        next += 1;
+        if (next_state < NR_STATES) {
+            g->state = next_state;
+        } else {
+            before = c->nr_guesses;
+            if (!guess_act(c, g, next_state)) {
+                return FALSE;
+            }
+            if (c->nr_guesses > before) {
+                if (!run_guess(c, before, next, end)) {
+                    drop_guess(c, before);
+                }
+                g = &c->guesses[i];
+            }
+        }
+    }
+    return !c->abandoned;
+}
+
+
+static int
+same_guess(struct guess* a, struct guess* b)
+{
+    return a->state == b->state && a->utf8 == b->utf8 &&
+            a->popped == b->popped && a->high == b->high &&
+            a->needs == b->needs && a->count == b->count &&
+            (a->needs == 0 || memcmp(a->need, b->need, a->needs) == 0) &&
+            (a->count == 0 || memcmp(a->modes, b->modes, a->count) == 0);
+}
+
+
+static void
+summarize_chunk(struct chunk* c, uint32_t entries)
+{
+/*
+    Run the guesses for every entry state over the chunk. They are run in
+    windows of doubling size, and after each window the guesses that have
+    reached the same condition are merged, so the number that must go on to
+    the end of the chunk stays small.
+*/
+    const unsigned char* from = c->start;
+    const unsigned char* to;
+    size_t window = 64;
+    int i, j;
+
+    c->nr_guesses = 0;
+    c->abandoned = FALSE;
+    for (i = 0; i < NR_STATES; i += 1) {
+        if (entries & ((uint32_t)1 << i)) {
+            memset(&c->guesses[c->nr_guesses], 0, sizeof(struct guess));
+            c->guesses[c->nr_guesses].entries = (uint32_t)1 << i;
+            c->guesses[c->nr_guesses].state = i;
+            c->nr_guesses += 1;
+        }
+    }
+    while (from < c->end && c->nr_guesses > 0 && !c->abandoned) {
+        to = ((size_t)(c->end - from) > window)
+            ? from + window
+            : c->end;
+        window *= 2;
+        for (i = c->nr_guesses - 1; i >= 0; i -= 1) {
+            if (!run_guess(c, i, from, to)) {
+                if (c->abandoned) {
+                    return;
+                }
+                drop_guess(c, i);
+            }
+        }
+        for (i = 0; i < c->nr_guesses; i += 1) {
+            for (j = c->nr_guesses - 1; j > i; j -= 1) {
+                if (same_guess(&c->guesses[i], &c->guesses[j])) {
+                    c->guesses[i].entries |= c->guesses[j].entries;
+                    drop_guess(c, j);
+                }
+            }
+        }
+        from = to;
+    }
+}
+
+
+static int
+mode_at(JSON_checker jc, int level)
+{
+    return (int)(jc->stack[level / LEVELS_PER_WORD] >>
+            (level % LEVELS_PER_WORD * 2)) & 3;
+}
+
+
+static int
+apply_chunk(JSON_checker jc, struct chunk* c)
+{
+/*
+    Find the guess that matches the real state and stack, and apply it. Return
+    false if the text is rejected.
+*/
+    struct guess* g;
+    int count = (c->abandoned || jc->utf8 != 0)
+        ? 0
+        : c->nr_guesses;
+    int i, j;
+
+    for (i = 0; i < count; i += 1) {
+        g = &c->guesses[i];
+        if ((g->entries & ((uint32_t)1 << jc->state)) == 0 ||
+                g->needs > jc->top + 1) {
+            continue;
+        }
+        for (j = 0; j < g->needs; j += 1) {
+            if ((g->need[j] & (1 << mode_at(jc, jc->top - j))) == 0) {
+                break;
+            }
+        }
+        if (j < g->needs) {
+            continue;
+        }
+        if (jc->top + g->high >= jc->depth) {
+            break;
+        }
+        jc->top -= g->popped;
+        for (j = 0; j < g->count; j += 1) {
+            if (!push(jc, g->modes[j])) {
+                return fail(jc, jc->offset, NO_MEMORY);
+            }
+        }
+        jc->state = g->state;
+        jc->utf8 = g->utf8;
+        jc->offset += (size_t)(c->end - c->start);
+        return TRUE;
+    }
+
+/*
+    The chunk was abandoned, or no guess fits, which means that the text is
+    rejected somewhere in this chunk. Check it again sequentially, which also
+    finds exactly where.
+*/
+    return JSON_checker_buffer(
+        jc,
+        (const char*)c->start,
+        (size_t)(c->end - c->start)
+    );
+}
+
+
+struct parallel {
+    pthread_mutex_t lock;
+    struct chunk* chunks;
+    int nr_chunks;
+    int next;
+    uint32_t first_entries;
+};
+
+
+static void*
+parallel_worker(void* arg)
+{
+    struct parallel* work = (struct parallel*)arg;
+    int i;
+    for (;;) {
+        pthread_mutex_lock(&work->lock);
+        i = work->next;
+        work->next += 1;
+        pthread_mutex_unlock(&work->lock);
+        if (i >= work->nr_chunks) {
+            return NULL;
+        }
+        summarize_chunk(
+            &work->chunks[i],
+            (i == 0)
+                ? work->first_entries
+                : ((uint32_t)1 << NR_STATES) - 1
+        );
+    }
+}
+
+
+int
+JSON_checker_parallel(
+    JSON_checker jc,
+    const char* p,
+    size_t length,
+    int threads
+)
+{
+/*
+    JSON_checker_parallel has the same effect as JSON_checker_buffer, but uses
+    up to threads threads to do it. It is meant for very large texts. Small
+    texts, a thread count of 1, and a JSON_checker that is recording an index,
+    delivering events, selecting, minifying, or counting just use
+    JSON_checker_buffer.
+*/
+    struct parallel work;
+    pthread_t* tids;
+    const unsigned char* u = (const unsigned char*)p;
+    size_t chunk_size;
+    size_t at;
+    int nr_chunks;
+    int result = TRUE;
+    int i, t;
+
+    if (jc->valid != GOOD) {
+        return FALSE;
+    }
+    if (threads <= 1 || length < 2 * MIN_CHUNK || jc->index != NULL ||
+            jc->handler != NULL || jc->select != NULL || jc->minify != NULL ||
+            jc->stats != NULL) {
+        return JSON_checker_buffer(jc, p, length);
+    }
+
+/*
+    Finish any character that an earlier call left incomplete, so that the
+    first chunk also begins between characters.
+*/
+    at = 0;
+    while (jc->utf8 != 0 && at < length && at < 3 && (u[at] & 0xC0) == 0x80) {
+        at += 1;
+    }
+    if (at > 0) {
+        if (!JSON_checker_buffer(jc, p, at)) {
+            return FALSE;
+        }
+        p += at;
+        u += at;
+        length -= at;
+    }
+    nr_chunks = threads * 4;
+    chunk_size = length / nr_chunks;
+    if (chunk_size < MIN_CHUNK) {
+        chunk_size = MIN_CHUNK;
+        nr_chunks = (int)(length / chunk_size);
+    }
+    work.chunks = (struct chunk*)malloc(nr_chunks * sizeof(struct chunk));
+    tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    if (work.chunks == NULL || tids == NULL) {
+        free(work.chunks);
+        free(tids);
+        return JSON_checker_buffer(jc, p, length);
+    }
+
+/*
+    Cut the buffer into chunks. In strict UTF-8 mode, a chunk never begins with
+    a continuation byte, so that no chunk begins inside of a character.
+*/
+    at = 0;
+    for (i = 0; i < nr_chunks; i += 1) {
+        work.chunks[i].start = u + at;
+        at = (i == nr_chunks - 1 || length - at < chunk_size)
+            ? length
+            : at + chunk_size;
+        if (jc->options & JSON_CHECKER_UTF8) {
+            while (at < length && (u[at] & 0xC0) == 0x80) {
+                at += 1;
+            }
+        }
+        work.chunks[i].end = u + at;
+        work.chunks[i].options = jc->options;
+        work.chunks[i].nr_guesses = 0;
+    }
+    pthread_mutex_init(&work.lock, NULL);
+    work.nr_chunks = nr_chunks;
+    work.next = 0;
+    work.first_entries = (uint32_t)1 << jc->state;
+
+    for (t = 0; t < threads; t += 1) {
+        if (pthread_create(&tids[t], NULL, parallel_worker, &work) != 0) {
+            break;
+        }
+    }
+    if (t == 0) {
+        parallel_worker(&work);
+    }
+    while (t > 0) {
+        t -= 1;
+        pthread_join(tids[t], NULL);
+    }
+    pthread_mutex_destroy(&work.lock);
+
+/*
+    Stitch the chunks together in order.
+*/
+    for (i = 0; i < nr_chunks; i += 1) {
+        if (result) {
+            result = apply_chunk(jc, &work.chunks[i]);
+        }
+        while (work.chunks[i].nr_guesses > 0) {
+            drop_guess(&work.chunks[i], 0);
+        }
+    }
+    free(work.chunks);
+    free(tids);
+    return result;
+}
+
+
+/*
+    Batch checking
+
+    JSON_checker_validate_batch checks many independent texts at once. Each
+    thread keeps one JSON_checker for the whole batch, and resets it for each
+    text, so checking a text allocates nothing. The JSON_checkers are made
+    before the threads are started.
+
+    Every thread owns a queue, which is a range of the batch. The batch is
+    first cut into ranges of about the same number of bytes, not of texts. A
+    thread takes texts one at a time from the front of its own range. When its
+    range is used up, it steals the back half of the range of another thread.
+    So a thread that drew a huge text is relieved of the texts behind it, and
+    the batch stays balanced however the sizes are mixed. A queue is padded to
+    a cache line of its own, so that the threads do not slow each other down
+    by writing to their neighbors' lines.
+*/
+
+#define CACHE_LINE 64
+
+struct batch_queue {
+    pthread_mutex_t lock;
+    size_t next;
+    size_t end;
+    char padding[CACHE_LINE];
+};
+
+struct batch {
+    const char** texts;
+    const size_t* lengths;
+    uint8_t* results;
+    int depth;
+    int options;
+    int nr_queues;
+    struct batch_queue* queues;
+};
+
+struct batch_worker {
+    struct JSON_checker_struct jc;
+    struct batch* batch;
+    pthread_t tid;
+    int self;
+    size_t accepted;
+};
+
+
+static int
+batch_take(struct batch_queue* queue, size_t* i)
+{
+/*
+    Take the next text from the front of a queue. Return false if it is empty.
+*/
+    int found;
+    pthread_mutex_lock(&queue->lock);
+    found = queue->next < queue->end;
+    if (found) {
+        *i = queue->next;
+        queue->next += 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+
+static int
+batch_steal(struct batch* batch, int self)
+{
+/*
+    Move the back half of another thread's queue into this thread's empty
+    queue. Return false if every queue is empty. Nothing is ever added to a
+    batch, so once that is seen, the work is done.
+*/
+    struct batch_queue* victim;
+    size_t first = 0;
+    size_t last = 0;
+    int k;
+
+    for (k = 1; k < batch->nr_queues && first == last; k += 1) {
+        victim = &batch->queues[(self + k) % batch->nr_queues];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->next < victim->end) {
+            last = victim->end;
+            first = last - (victim->end - victim->next + 1) / 2;
+            victim->end = first;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    if (first == last) {
+        return FALSE;
+    }
+    pthread_mutex_lock(&batch->queues[self].lock);
+    batch->queues[self].next = first;
+    batch->queues[self].end = last;
+    pthread_mutex_unlock(&batch->queues[self].lock);
+    return TRUE;
+}
+
+
+static void*
+batch_worker(void* arg)
+{
+    struct batch_worker* worker = (struct batch_worker*)arg;
+    struct batch* batch = worker->batch;
+    JSON_checker jc = &worker->jc;
+    size_t i;
+
+    do {
+        while (batch_take(&batch->queues[worker->self], &i)) {
+            JSON_checker_reset(jc);
+            batch->results[i] = (uint8_t)(
+                JSON_checker_buffer(jc, batch->texts[i], batch->lengths[i])
+                && JSON_checker_done(jc)
+            );
+            worker->accepted += batch->results[i];
+        }
+    } while (batch_steal(batch, worker->self));
+    return NULL;
+}
+
+
+size_t
+JSON_checker_validate_batch(
+    const char** texts,
+    const size_t* lengths,
+    size_t count,
+    uint8_t* results,
+    int depth,
+    int options,
+    int threads
+)
+{
+/*
+    Check count independent JSON texts with up to threads threads, including
+    the calling thread. results[i] is set to 1 if texts[i] is accepted, and to
+    0 if it is not. Return the number of texts that were accepted.
+*/
+    struct batch batch;
+    struct batch_worker* workers;
+    struct batch_queue one_queue;
+    struct batch_worker one_worker;
+    size_t total = 0;
+    size_t share;
+    size_t sum;
+    size_t accepted = 0;
+    size_t i;
+    int t;
+
+    if ((size_t)threads > count) {
+        threads = (int)count;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+/*
+    A batch for one thread, or one for which there is not memory enough, is
+    checked on this thread alone with a single queue.
+*/
+    batch.queues = &one_queue;
+    workers = &one_worker;
+    if (threads > 1) {
+        batch.queues = (struct batch_queue*)malloc(
+            threads * sizeof(struct batch_queue)
+        );
+        workers = (struct batch_worker*)malloc(
+            threads * sizeof(struct batch_worker)
+        );
+        if (batch.queues == NULL || workers == NULL) {
+            free(batch.queues);
+            free(workers);
+            batch.queues = &one_queue;
+            workers = &one_worker;
+            threads = 1;
+        }
+    }
+    batch.texts = texts;
+    batch.lengths = lengths;
+    batch.results = results;
+    batch.depth = depth;
+    batch.options = options;
+    batch.nr_queues = threads;
+
+/*
+    Cut the batch into ranges of about the same number of bytes. Every text
+    counts for a few bytes more than its length, for the cost of starting it.
+*/
+    for (i = 0; i < count; i += 1) {
+        total += lengths[i] + CACHE_LINE;
+    }
+    share = total / threads + 1;
+    sum = 0;
+    i = 0;
+    for (t = 0; t < threads; t += 1) {
+        pthread_mutex_init(&batch.queues[t].lock, NULL);
+        batch.queues[t].next = i;
+        while (i < count && (sum < share * (t + 1) || t == threads - 1)) {
+            sum += lengths[i] + CACHE_LINE;
+            i += 1;
+        }
+        batch.queues[t].end = i;
+        workers[t].batch = &batch;
+        workers[t].self = t;
+        workers[t].accepted = 0;
+        init_JSON_checker(&workers[t].jc, depth);
+        JSON_checker_set_options(&workers[t].jc, options);
+    }
+
+/*
+    The calling thread is worker 0. If a thread can not be started, its queue
+    is left for the others to steal.
+*/
+    for (t = 1; t < threads; t += 1) {
+        if (pthread_create(&workers[t].tid, NULL, batch_worker,
+                &workers[t]) != 0) {
+            workers[t].self = -1;
+        }
+    }
+    batch_worker(&workers[0]);
+    for (t = 1; t < threads; t += 1) {
+        if (workers[t].self >= 0) {
+            pthread_join(workers[t].tid, NULL);
+        }
+    }
+    for (t = 0; t < threads; t += 1) {
+        accepted += workers[t].accepted;
+        JSON_checker_release(&workers[t].jc);
+        pthread_mutex_destroy(&batch.queues[t].lock);
+    }
+    if (threads > 1) {
+        free(batch.queues);
+        free(workers);
+    }
+    return accepted;
 }
@@ -1,18 +1,175 @@
 /* JSON_checker.h */
 
-/* 2016-11-11 */
+/* 2026-10-17 */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_CHECKER_INLINE_WORDS 2
+
+#define JSON_CHECKER_UTF8 1
+
+/*
+    A JSON_index receives the byte offsets of the structure of a JSON text as
+    it is checked. It belongs to the caller, who may start it empty (all
+    zeros) or give it an array from malloc. offsets is grown with realloc as
+    needed, and count is the number of offsets in it.
+*/
+
+typedef struct JSON_index_struct {
+    uint32_t* offsets;
+    size_t count;
+    size_t capacity;
+} * JSON_index;
+
+/*
+    A JSON_handler receives the events of a JSON text as it is checked, in the
+    manner of SAX. Each callback is given the context. A callback that is NULL
+    is not called. A callback returns true to continue, or false to stop,
+    which rejects the text.
+
+    Keys, strings, and numbers are given as slices of the text. A slice is the
+    raw text of the token: a string without its quotes and with its escapes
+    left as they are. When a token lies within a single buffer, the slice
+    points into that buffer. When a token spans buffers, it is gathered into a
+    buffer inside the JSON_checker, and the slice points there. Either way, the
+    slice is only good until the callback returns.
+*/
+
+typedef struct JSON_handler_struct {
+    void* context;
+    int (*begin_object)(void* context);
+    int (*end_object)(void* context);
+    int (*begin_array)(void* context);
+    int (*end_array)(void* context);
+    int (*key)(void* context, const char* p, size_t length);
+    int (*string)(void* context, const char* p, size_t length);
+    int (*number)(void* context, const char* p, size_t length);
+    int (*boolean)(void* context, int value);
+    int (*null)(void* context);
+} * JSON_handler;
+
+/*
+    A JSON_error receives a description of the place where a text was
+    rejected. offset is the position of the offending byte, counting from the
+    first byte after JSON_checker_reset, or the length of the text if the text
+    ended too soon. character is that byte, -1 at the end of the text, or -2
+    if memory ran out while growing a JSON_minify or while joining the chunks
+    of JSON_checker_parallel. character_class and state name the class of the
+    character ("end of text" or "out of memory" for -1 and -2) and the state
+    the checker was in. depth is the number of containers that were open.
+    line and column are 0 until JSON_error_locate computes them.
+*/
+
+typedef struct JSON_error_struct {
+    size_t offset;
+    size_t line;
+    size_t column;
+    int character;
+    int depth;
+    const char* character_class;
+    const char* state;
+} * JSON_error;
+
+/*
+    A JSON_select names up to 64 values of a text by JSON Pointers (RFC 6901),
+    such as "/user/name" or "/items/0". When the text has been checked,
+    offsets[i] and lengths[i] give the bytes of the value of pointers[i],
+    counting from the first byte after JSON_checker_reset. lengths[i] is 0 if
+    there is no such value. The empty pointer names the whole text. If a key
+    appears more than once, the first value is taken.
+*/
+
+typedef struct JSON_select_struct {
+    const char** pointers;
+    int count;
+    size_t* offsets;
+    size_t* lengths;
+} * JSON_select;
+
+/*
+    A JSON_minify receives a copy of a JSON text without the whitespace between
+    its tokens. It belongs to the caller, who may start it empty (all zeros) or
+    give it an array from malloc. bytes is grown with realloc as needed, and
+    length is the number of bytes in it. The copy is not terminated with a
+    NUL.
+*/
+
+typedef struct JSON_minify_struct {
+    char* bytes;
+    size_t length;
+    size_t capacity;
+} * JSON_minify;
+
+/*
+    A JSON_stats receives counts of what the checker saw, to profile a
+    workload. It is only filled in if JSON_checker.c was compiled with
+    JSON_CHECKER_STATS defined; otherwise the counting is not compiled at all.
+    It belongs to the caller, who should start it with all zeros. The counts
+    go on adding up across texts until the caller clears them.
+
+    Every byte that is accepted is counted in one of the first five fields.
+    string_bytes includes the quotes and the escapes, and number_bytes and
+    literal_bytes the characters of numbers and of true, false, and null.
+    white_bytes is the whitespace between tokens, and structure_bytes the
+    brackets, colons, and commas. actions[n] counts action -n of the state
+    transition table: 2 colon, 3 comma, 4 closing quote, 5 [, 6 {, 7 ], 8 }, and
+    9 the } of an empty object. escapes counts the backslashes that begin
+    escapes, and unicode_escapes those that are followed by u. The longest
+    string is measured between its quotes, as written. last, string_start,
+    and number_start are byte offsets that are used while counting.
+*/
+
+typedef struct JSON_stats_struct {
+    size_t string_bytes;
+    size_t number_bytes;
+    size_t literal_bytes;
+    size_t white_bytes;
+    size_t structure_bytes;
+    size_t actions[10];
+    size_t escapes;
+    size_t unicode_escapes;
+    size_t longest_string;
+    size_t longest_number;
+    int max_depth;
+    size_t last;
+    size_t string_start;
+    size_t number_start;
+} * JSON_stats;
 
 /*
     The JSON_checker_struct is used to hold the state of the JSON_checker
-    so that the code can be reentrant.
+    so that the code can be reentrant. The stack holds one 2-bit mode per
+    level of nesting. It starts in inline_stack, which holds 64 levels, and
+    moves to the heap only if the text nests deeper than that.
 */
 
 typedef struct JSON_checker_struct {
-    int valid;
+    unsigned int valid;
     int state;
+    int options;
+    int utf8;
     int depth;
     int top;
-    int* stack;
+    int size;
+    uint64_t* stack;
+    uint64_t inline_stack[JSON_CHECKER_INLINE_WORDS];
+    int allocated;
+    size_t offset;
+    JSON_index index;
+    JSON_handler handler;
+    JSON_error error;
+    JSON_select select;
+    struct JSON_select_cursor* cursor;
+    JSON_minify minify;
+    JSON_stats stats;
+    int encoding;
+    int surrogate;
+    int partial_length;
+    unsigned char partial[4];
+    char* spill;
+    size_t spill_length;
+    size_t spill_size;
 } * JSON_checker;
 
 
@@ -24,13 +181,221 @@ extern JSON_checker new_JSON_checker(int depth);
     They will destroy the object for you.
 */
 
+extern JSON_checker init_JSON_checker(struct JSON_checker_struct* jc, int depth);
+
+/*
+    Make a JSON_checker in a struct that you provide, for example as a local
+    variable. The object is not destroyed when the text is rejected or when
+    JSON_checker_done is called, so it can be used again after
+    JSON_checker_reset. Memory is only allocated if a text nests more than 64
+    levels deep.
+*/
+
+extern void JSON_checker_release(JSON_checker jc);
+
+/*
+    Free any memory held by a JSON_checker made by init_JSON_checker.
+*/
+
+extern void JSON_checker_reset(JSON_checker jc);
+
+/*
+    Prepare a JSON_checker to check another JSON text.
+*/
+
+extern void JSON_checker_set_options(JSON_checker jc, int options);
+
+/*
+    Turn on optional checks before the first character.
+
+    JSON_CHECKER_UTF8   The text must be strict UTF-8. Multibyte sequences in
+                        strings are held to the rules of utf8_decode.c, and
+                        characters must be passed as single bytes.
+*/
+
+extern void JSON_checker_set_index(JSON_checker jc, JSON_index index);
+
+/*
+    Record the structure of the text in index while it is checked, or stop
+    recording if index is NULL. An offset is added for every { } [ ] : and ,
+    and for the first byte of every value and key: the opening quote of a
+    string, or the first character of a number, true, false, or null. Offsets
+    count from the first byte after JSON_checker_reset, so a text must be
+    smaller than 4 GB. The text is rejected if the index can not grow. The
+    index is kept across JSON_checker_reset; set its count to 0 to reuse it.
+*/
+
+extern void JSON_checker_set_handler(JSON_checker jc, JSON_handler handler);
+
+/*
+    Deliver the events of the text to handler while it is checked, or stop if
+    handler is NULL. A JSON_checker with a handler must be given bytes of
+    UTF-8. The handler is kept across JSON_checker_reset.
+*/
+
+extern int JSON_checker_set_select(JSON_checker jc, JSON_select select);
+
+/*
+    Find the values named by select while the text is checked, or stop if
+    select is NULL. A subtree that can not hold any of them is not checked,
+    but is passed over by counting its brackets, and once all of them have been
+    found the rest of the text is passed over too. So the result of
+    JSON_checker_done only promises that the parts that were read are right and
+    that the brackets balance. Neither an index nor a handler is served while
+    selecting. It returns false if there are more than 64 pointers or if memory
+    runs out. The select is kept across JSON_checker_reset, and is let go by
+    JSON_checker_release.
+*/
+
+extern void JSON_checker_set_minify(JSON_checker jc, JSON_minify minify);
+
+/*
+    Write the text to minify while it is checked, leaving out the whitespace
+    that the checker finds outside of strings, or stop if minify is NULL. The
+    text is read only once. A JSON_checker that minifies must be given bytes
+    of UTF-8. If the text is accepted, minify holds the same JSON text with
+    the same tokens. If it is rejected, or if minify can not grow, minify
+    holds the part that came before the error. An index is still recorded,
+    but neither a handler nor a select is served while minifying. The minify
+    is kept across JSON_checker_reset; set its length to 0 to reuse it.
+*/
+
+extern int JSON_checker_set_stats(JSON_checker jc, JSON_stats stats);
+
+/*
+    Count into stats while the text is checked, or stop if stats is NULL. It
+    returns false, and counts nothing, if JSON_checker.c was compiled without
+    JSON_CHECKER_STATS. The bytes that a select passes over are not counted,
+    and a JSON_checker that is counting does not use threads. The stats are
+    kept across JSON_checker_reset.
+*/
+
+extern void JSON_checker_set_error(JSON_checker jc, JSON_error error);
+
+/*
+    Fill in error if the text is rejected, or stop if error is NULL. Only a
+    byte counter is kept while checking; the record is written when the text
+    is rejected, even if the JSON_checker is then deleted. The error record is
+    kept across JSON_checker_reset.
+*/
+
+extern void JSON_error_locate(JSON_error error, const char* text, size_t length);
+
+/*
+    Compute the line and column of an error from its offset. text is the JSON
+    text, or as much of it as is at hand, from its first byte. Lines are
+    counted from 1 and end with a linefeed. Columns are counted in bytes from
+    1.
+*/
+
 extern int JSON_checker_char(JSON_checker jc, int next_char);
 
 /*
     You should call JSON_checker_char for each character of the JSON text.
+    It will return false if the text is not right. For UTF-16 and UTF-32
+    text, the buffer functions below are faster, and also check that the
+    surrogates are paired.
+*/
+
+extern int JSON_checker_buffer(JSON_checker jc, const char* p, size_t length);
+
+/*
+    JSON_checker_buffer checks length bytes of UTF-8 text at once. It is much
+    faster than calling JSON_checker_char for each byte. It can be called
+    repeatedly as more of the text becomes available.
     It will return false if the text is not right.
 */
 
+extern int JSON_checker_utf16le(JSON_checker jc, const char* p, size_t length);
+extern int JSON_checker_utf16be(JSON_checker jc, const char* p, size_t length);
+extern int JSON_checker_utf32le(JSON_checker jc, const char* p, size_t length);
+extern int JSON_checker_utf32be(JSON_checker jc, const char* p, size_t length);
+
+/*
+    These are JSON_checker_buffer for text in UTF-16 or UTF-32, given as length
+    bytes in the named byte order. A piece may end in the middle of a code
+    unit or of a surrogate pair; the rest is taken from the next call. A
+    byte order mark at the beginning of the text is skipped. A surrogate
+    that is not half of a pair, or a UTF-32 unit that is a surrogate or is
+    above U+10FFFF, rejects the text. Offsets, in the index and in the error,
+    count code units, as they do for JSON_checker_char. The text is not
+    converted; code units that are ASCII are narrowed to bytes with vector
+    instructions and checked as they are. A JSON_checker with a handler, a
+    select, or a minify must be given UTF-8, so they reject the text.
+*/
+
+extern int JSON_checker_unicode(JSON_checker jc, const char* p, size_t length);
+
+/*
+    JSON_checker_unicode is for a text whose encoding is not known. The first
+    4 bytes are held until the encoding can be taken from the byte order mark,
+    or else from the pattern of zero bytes in them, which are ASCII in any
+    JSON text (RFC 4627). The text is then checked as UTF-8, with a UTF-8 byte
+    order mark skipped, or by one of the functions above. The calls may split
+    the text anywhere.
+*/
+
+extern int JSON_checker_parallel(
+    JSON_checker jc,
+    const char* p,
+    size_t length,
+    int threads
+);
+
+/*
+    JSON_checker_parallel is like JSON_checker_buffer, but it checks a large
+    text with up to threads threads. Its result is the same.
+*/
+
+extern size_t JSON_checker_validate_batch(
+    const char** texts,
+    const size_t* lengths,
+    size_t count,
+    uint8_t* results,
+    int depth,
+    int options,
+    int threads
+);
+
+/*
+    JSON_checker_validate_batch checks count independent JSON texts, such as
+    a batch of messages, with up to threads threads. results[i] is set to 1 if
+    texts[i] is accepted and to 0 if it is not. depth and options apply to
+    every text. It returns the number of texts that were accepted. The threads
+    steal work from each other, so a mix of tiny and huge texts is balanced.
+*/
+
+extern size_t JSON_checker_save(JSON_checker jc, void* blob, size_t size);
+
+/*
+    Save the place of a JSON_checker in the middle of a text as a checkpoint,
+    a small blob of bytes that can be kept in a file. The blob holds the
+    state, the stack of modes, the byte counter, the options, and any part of
+    a token that is waiting for a handler, in a form that does not depend on
+    the machine. It returns the size of the blob, which is written to blob
+    only if it fits in size bytes, so a first call with a size of 0 gives the
+    size that is needed. The encoding used by the functions for UTF-16 and
+    UTF-32 is kept, but a blob can not be saved in the middle of one of their
+    characters. It returns 0 if the JSON_checker has rejected its text, has
+    been done, is selecting, or is in the middle of such a character.
+*/
+
+extern int JSON_checker_restore(
+    JSON_checker jc,
+    const void* blob,
+    size_t size
+);
+
+/*
+    Return a JSON_checker to the place saved in blob, so that it continues
+    with the byte that follows, perhaps in another process. The depth of jc
+    is kept, and must be enough for the modes in the blob. Byte offsets go on
+    counting from where the saved text began. It returns false if the blob is
+    damaged or does not fit, or if jc is selecting, and leaves jc as if it
+    had just been reset. The index, handler, error, and minify of jc are
+    kept.
+*/
+
 extern int JSON_checker_done(JSON_checker jc);
 
 /*
@@ -0,0 +1,532 @@
+/* JSON_checker.hpp */
+
+/* 2026-10-17 */
+
+/*
+    A C++ front end to JSON_checker, for programs that always check with the
+    same depth and encoding. It needs C++14.
+
+        json_checker<64, json_encoding::utf8> jc;
+        if (!jc.buffer(text, length) || !jc.done()) {
+            ...
+        }
+
+    json_checker<MaxDepth, Encoding, Options> is the same pushdown automaton
+    as JSON_checker.c, and accepts exactly the same texts, but everything that
+    the C version decides at run time is decided here by the compiler:
+
+        MaxDepth    The depth, as given to new_JSON_checker. The stack is an
+                    array of MaxDepth 2-bit modes inside of the object, so
+                    nothing is ever allocated.
+
+        Encoding    json_encoding::bytes takes 8-bit units without looking
+                    inside of multibyte sequences, like JSON_checker_char.
+                    json_encoding::utf8 also holds them to the rules of
+                    utf8_decode.c, like the JSON_CHECKER_UTF8 option.
+                    json_encoding::utf16 and json_encoding::utf32 take
+                    char16_t and char32_t units, as JSON_checker_char takes
+                    ints.
+
+        Options     json_offsets keeps a count of the units that have been
+                    accepted, so that offset() gives the position of the
+                    unit that was rejected, like the offset of a JSON_error.
+                    Without it, no count is kept.
+
+    The character class table and the state transition table are built by
+    constexpr functions, and then folded into one table from a state and a
+    byte to the next state or action, so each unit costs one lookup. It is
+    much faster than JSON_checker_char, but it has none of the vector kernels
+    of JSON_checker_buffer, which is still the faster way to check long
+    strings and deep indentation.
+
+    Like a JSON_checker made by init_JSON_checker, a json_checker is never
+    deleted. Once it has rejected a text or been given done, it accepts
+    nothing more until reset.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+enum class json_encoding {
+    bytes,
+    utf8,
+    utf16,
+    utf32
+};
+
+enum json_options : unsigned {
+    json_offsets = 1
+};
+
+
+namespace json_checker_detail {
+
+/*
+    The character classes, the states, and the modes are those of
+    JSON_checker.c.
+*/
+
+enum classes {
+    C_SPACE, C_WHITE, C_LCURB, C_RCURB, C_LSQRB, C_RSQRB, C_COLON, C_COMMA,
+    C_QUOTE, C_BACKS, C_SLASH, C_PLUS,  C_MINUS, C_POINT, C_ZERO,  C_DIGIT,
+    C_LOW_A, C_LOW_B, C_LOW_C, C_LOW_D, C_LOW_E, C_LOW_F, C_LOW_L, C_LOW_N,
+    C_LOW_R, C_LOW_S, C_LOW_T, C_LOW_U, C_ABCDF, C_E,     C_ETC,   C_CTRL,
+    NR_CLASSES
+};
+
+enum states {
+    GO, OK, OB, KE, CO, VA, AR, ST, ES, U1, U2, U3, U4, MI, ZE, IN,
+    FR, FS, E1, E2, E3, T1, T2, T3, F1, F2, F3, F4, N1, N2, N3,
+    NR_STATES
+};
+
+enum modes {
+    MODE_ARRAY,
+    MODE_DONE,
+    MODE_KEY,
+    MODE_OBJECT
+};
+
+enum {
+    __ = -1
+};
+
+
+constexpr int byte_class(int c) {
+/*
+    Map a byte into its character class. Bytes 128 through 255 are the parts
+    of UTF-8 multibyte sequences, and are C_ETC.
+*/
+    return c == ' ' ? C_SPACE
+        : (c == '\t' || c == '\n' || c == '\r') ? C_WHITE
+        : c < 0x20 ? C_CTRL
+        : c == '{' ? C_LCURB
+        : c == '}' ? C_RCURB
+        : c == '[' ? C_LSQRB
+        : c == ']' ? C_RSQRB
+        : c == ':' ? C_COLON
+        : c == ',' ? C_COMMA
+        : c == '"' ? C_QUOTE
+        : c == '\\' ? C_BACKS
+        : c == '/' ? C_SLASH
+        : c == '+' ? C_PLUS
+        : c == '-' ? C_MINUS
+        : c == '.' ? C_POINT
+        : c == '0' ? C_ZERO
+        : (c >= '1' && c <= '9') ? C_DIGIT
+        : c == 'a' ? C_LOW_A
+        : c == 'b' ? C_LOW_B
+        : c == 'c' ? C_LOW_C
+        : c == 'd' ? C_LOW_D
+        : c == 'e' ? C_LOW_E
+        : c == 'f' ? C_LOW_F
+        : c == 'l' ? C_LOW_L
+        : c == 'n' ? C_LOW_N
+        : c == 'r' ? C_LOW_R
+        : c == 's' ? C_LOW_S
+        : c == 't' ? C_LOW_T
+        : c == 'u' ? C_LOW_U
+        : (c >= 'A' && c <= 'F' && c != 'E') ? C_ABCDF
+        : c == 'E' ? C_E
+        : C_ETC;
+}
+
+
+/*
+    The state transition table of JSON_checker.c. A state is a new state, and
+    a negative number is an action:
+
+        -2 :    -3 ,    -4 "    -5 [    -6 {    -7 ]    -8 }    -9 empty }
+*/
+
+constexpr signed char state_transition_table[NR_STATES][NR_CLASSES] = {
+/*
+                 white                                      1-9                                   ABCDF  etc ctrl
+             space |  {  }  [  ]  :  ,  "  \  /  +  -  .  0  |  a  b  c  d  e  f  l  n  r  s  t  u  |  E  |  |*/
+/*start  GO*/ {GO,GO,-6,__,-5,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*ok     OK*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*object OB*/ {OB,OB,__,-9,__,__,__,__,ST,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*key    KE*/ {KE,KE,__,__,__,__,__,__,ST,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*colon  CO*/ {CO,CO,__,__,__,__,-2,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*value  VA*/ {VA,VA,-6,__,-5,__,__,__,ST,__,__,__,MI,__,ZE,IN,__,__,__,__,__,F1,__,N1,__,__,T1,__,__,__,__,__},
+/*array  AR*/ {AR,AR,-6,__,-5,-7,__,__,ST,__,__,__,MI,__,ZE,IN,__,__,__,__,__,F1,__,N1,__,__,T1,__,__,__,__,__},
+/*string ST*/ {ST,__,ST,ST,ST,ST,ST,ST,-4,ES,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,ST,__},
+/*escape ES*/ {__,__,__,__,__,__,__,__,ST,ST,ST,__,__,__,__,__,__,ST,__,__,__,ST,__,ST,ST,__,ST,U1,__,__,__,__},
+/*u1     U1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,U2,U2,U2,U2,U2,U2,U2,U2,__,__,__,__,__,__,U2,U2,__,__},
+/*u2     U2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,U3,U3,U3,U3,U3,U3,U3,U3,__,__,__,__,__,__,U3,U3,__,__},
+/*u3     U3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,U4,U4,U4,U4,U4,U4,U4,U4,__,__,__,__,__,__,U4,U4,__,__},
+/*u4     U4*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,ST,ST,ST,ST,ST,ST,ST,ST,__,__,__,__,__,__,ST,ST,__,__},
+/*minus  MI*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,ZE,IN,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*zero   ZE*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,FR,__,__,__,__,__,__,E1,__,__,__,__,__,__,__,__,E1,__,__},
+/*int    IN*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,FR,IN,IN,__,__,__,__,E1,__,__,__,__,__,__,__,__,E1,__,__},
+/*frac   FR*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,FS,FS,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*fracs  FS*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,__,FS,FS,__,__,__,__,E1,__,__,__,__,__,__,__,__,E1,__,__},
+/*e      E1*/ {__,__,__,__,__,__,__,__,__,__,__,E2,E2,__,E3,E3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*ex     E2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,E3,E3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*exp    E3*/ {OK,OK,__,-8,__,-7,__,-3,__,__,__,__,__,__,E3,E3,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*tr     T1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,T2,__,__,__,__,__,__,__},
+/*tru    T2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,T3,__,__,__,__},
+/*true   T3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,OK,__,__,__,__,__,__,__,__,__,__,__},
+/*fa     F1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,F2,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__},
+/*fal    F2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,F3,__,__,__,__,__,__,__,__,__},
+/*fals   F3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,F4,__,__,__,__,__,__},
+/*false  F4*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,OK,__,__,__,__,__,__,__,__,__,__,__},
+/*nu     N1*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,N2,__,__,__,__},
+/*nul    N2*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,N3,__,__,__,__,__,__,__,__,__},
+/*null   N3*/ {__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,__,OK,__,__,__,__,__,__,__,__,__}
+};
+
+
+/*
+    The folded table goes from a state and a byte straight to the next state,
+    or to an action. As in JSON_checker.c, an action is stored as 256 plus its
+    number, so every action is larger than every state. etc is the column for
+    units above 255.
+*/
+
+struct folded_table {
+    std::uint8_t next[NR_STATES][256];
+    std::uint8_t etc[NR_STATES];
+};
+
+constexpr folded_table fold() {
+    folded_table table{};
+    for (int state = 0; state < NR_STATES; state += 1) {
+        for (int c = 0; c < 256; c += 1) {
+            table.next[state][c] = static_cast<std::uint8_t>(
+                state_transition_table[state][byte_class(c)]
+            );
+        }
+        table.etc[state] = static_cast<std::uint8_t>(
+            state_transition_table[state][C_ETC]
+        );
+    }
+    return table;
+}
+
+
+/*
+    Strict UTF-8, as in JSON_checker.c. A position of 0 is between
+    characters, and the others give the range allowed for the next byte and
+    the position that follows it. lead gives the position after the first byte
+    of a sequence, or 8 if the byte can not begin one.
+*/
+
+struct utf8_table {
+    std::uint8_t low[9];
+    std::uint8_t high[9];
+    std::uint8_t after[9];
+    std::uint8_t lead[256];
+};
+
+constexpr utf8_table make_utf8_table() {
+    utf8_table table{
+        {0, 0x80, 0x80, 0xA0, 0x80, 0x80, 0x90, 0x80, 1},
+        {0, 0xBF, 0xBF, 0xBF, 0x9F, 0xBF, 0xBF, 0x8F, 0},
+        {0, 0, 1, 1, 1, 2, 2, 2, 8},
+        {}
+    };
+    for (int c = 0; c < 256; c += 1) {
+        table.lead[c] = c < 0x80 ? 0
+            : c < 0xC2 ? 8
+            : c < 0xE0 ? 1
+            : c == 0xE0 ? 3
+            : c == 0xED ? 4
+            : c < 0xF0 ? 2
+            : c == 0xF0 ? 6
+            : c < 0xF4 ? 5
+            : c == 0xF4 ? 7
+            : 8;
+    }
+    return table;
+}
+
+
+/*
+    The tables are static members of a template, so that a header can define
+    them once for the whole program.
+*/
+
+template <int Unused = 0>
+struct tables {
+    static constexpr folded_table folded = fold();
+    static constexpr utf8_table utf8 = make_utf8_table();
+};
+
+template <int Unused>
+constexpr folded_table tables<Unused>::folded;
+
+template <int Unused>
+constexpr utf8_table tables<Unused>::utf8;
+
+
+template <json_encoding Encoding>
+struct unit {
+    typedef unsigned char type;
+};
+
+template <>
+struct unit<json_encoding::utf16> {
+    typedef char16_t type;
+};
+
+template <>
+struct unit<json_encoding::utf32> {
+    typedef char32_t type;
+};
+
+}
+
+
+template <
+    int MaxDepth,
+    json_encoding Encoding = json_encoding::bytes,
+    unsigned Options = 0
+>
+class json_checker {
+    static_assert(MaxDepth >= 1, "the depth must be at least 1");
+
+public:
+    typedef typename json_checker_detail::unit<Encoding>::type unit_type;
+
+    json_checker() : stack_() {
+        reset();
+    }
+
+    void reset() {
+/*
+    Prepare for the next JSON text.
+*/
+        valid_ = true;
+        state_ = json_checker_detail::GO;
+        utf8_ = 0;
+        offset_ = 0;
+        top_ = -1;
+        push(json_checker_detail::MODE_DONE);
+    }
+
+    bool character(unit_type c) {
+/*
+    Check one more unit, like JSON_checker_char. Return false if the text is
+    rejected.
+*/
+        return buffer(&c, 1);
+    }
+
+    bool buffer(const unit_type* p, std::size_t length);
+
+    bool buffer(const char* p, std::size_t length) {
+/*
+    Check bytes held as chars. This is only for the byte encodings.
+*/
+        static_assert(
+            sizeof(unit_type) == 1,
+            "a wide encoding is checked in units, not chars"
+        );
+        return buffer(reinterpret_cast<const unit_type*>(p), length);
+    }
+
+    bool done() {
+/*
+    Return true if the units given so far are a whole JSON text. Like
+    JSON_checker_done, this ends the text, so reset must be called before the
+    next one.
+*/
+        if (!valid_) {
+            return false;
+        }
+        valid_ = false;
+        return state_ == json_checker_detail::OK &&
+            pop(json_checker_detail::MODE_DONE);
+    }
+
+    std::size_t offset() const {
+/*
+    The number of units accepted so far, which after a rejection is the
+    position of the unit that was rejected.
+*/
+        static_assert(
+            (Options & json_offsets) != 0,
+            "offset needs the json_offsets option"
+        );
+        return offset_;
+    }
+
+private:
+    enum {
+        levels_per_word = 32,
+        words = (MaxDepth + levels_per_word - 1) / levels_per_word
+    };
+
+    int mode() const {
+        return static_cast<int>(
+            stack_[top_ / levels_per_word] >> (top_ % levels_per_word * 2)
+        ) & 3;
+    }
+
+    bool push(int mode) {
+        std::uint64_t* word;
+        int shift;
+
+        top_ += 1;
+        if (top_ >= MaxDepth) {
+            return false;
+        }
+        word = &stack_[top_ / levels_per_word];
+        shift = top_ % levels_per_word * 2;
+        *word = (*word & ~(std::uint64_t{3} << shift)) |
+            (static_cast<std::uint64_t>(mode) << shift);
+        return true;
+    }
+
+    bool pop(int mode) {
+        if (top_ < 0 || this->mode() != mode) {
+            return false;
+        }
+        top_ -= 1;
+        return true;
+    }
+
+    bool act(int action);
+
+    std::uint64_t stack_[words];
+    std::size_t offset_;
+    int top_;
+    int state_;
+    int utf8_;
+    bool valid_;
+};
+
+
+template <int MaxDepth, json_encoding Encoding, unsigned Options>
+bool json_checker<MaxDepth, Encoding, Options>::act(int action) {
+/*
+    Perform an action of the state transition table, as the act_ functions of
+    JSON_checker.c do. Return false if it is not valid in the current mode.
+*/
+    using namespace json_checker_detail;
+
+    switch (action) {
+    case -2:
+        if (!pop(MODE_KEY) || !push(MODE_OBJECT)) {
+            return false;
+        }
+        state_ = VA;
+        return true;
+    case -3:
+        switch (mode()) {
+        case MODE_OBJECT:
+            if (!pop(MODE_OBJECT) || !push(MODE_KEY)) {
+                return false;
+            }
+            state_ = KE;
+            return true;
+        case MODE_ARRAY:
+            state_ = VA;
+            return true;
+        default:
+            return false;
+        }
+    case -4:
+        switch (mode()) {
+        case MODE_KEY:
+            state_ = CO;
+            return true;
+        case MODE_ARRAY:
+        case MODE_OBJECT:
+            state_ = OK;
+            return true;
+        default:
+            return false;
+        }
+    case -5:
+        if (!push(MODE_ARRAY)) {
+            return false;
+        }
+        state_ = AR;
+        return true;
+    case -6:
+        if (!push(MODE_KEY)) {
+            return false;
+        }
+        state_ = OB;
+        return true;
+    case -7:
+        if (!pop(MODE_ARRAY)) {
+            return false;
+        }
+        state_ = OK;
+        return true;
+    case -8:
+        if (!pop(MODE_OBJECT)) {
+            return false;
+        }
+        state_ = OK;
+        return true;
+    case -9:
+        if (!pop(MODE_KEY)) {
+            return false;
+        }
+        state_ = OK;
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+template <int MaxDepth, json_encoding Encoding, unsigned Options>
+bool json_checker<MaxDepth, Encoding, Options>::buffer(
+    const unit_type* p,
+    std::size_t length
+) {
+/*
+    Check length more units, like JSON_checker_buffer. Return false if the
+    text is rejected. The state is kept in a local for the length of the loop.
+    The tests on Encoding and Options are constant, so the compiler leaves out
+    the ones that do not apply.
+*/
+    using namespace json_checker_detail;
+    typedef tables<> t;
+    int state = state_;
+    int next;
+    std::size_t i;
+
+    if (!valid_) {
+        return false;
+    }
+    for (i = 0; i < length; i += 1) {
+        std::uint32_t c = p[i];
+        if (Encoding == json_encoding::utf8) {
+            if (utf8_ == 0) {
+                utf8_ = t::utf8.lead[c];
+            } else if (c < t::utf8.low[utf8_] || c > t::utf8.high[utf8_]) {
+                utf8_ = 8;
+            } else {
+                utf8_ = t::utf8.after[utf8_];
+            }
+            if (utf8_ == 8) {
+                valid_ = false;
+                break;
+            }
+        }
+        next = (sizeof(unit_type) == 1 || c < 256)
+            ? t::folded.next[state][c]
+            : t::folded.etc[state];
+        if (next < NR_STATES) {
+            state = next;
+        } else {
+            state_ = state;
+            if (!act(next - 256)) {
+                valid_ = false;
+                break;
+            }
+            state = state_;
+        }
+    }
+    state_ = state;
+    if (Options & json_offsets) {
+        offset_ += i;
+    }
+    return valid_;
+}
@@ -0,0 +1,45 @@
+/* JSON_number.h */
+
+/* 2026-10-17 */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    The kinds of value that a number can have.
+*/
+
+enum JSON_number_types {
+    JSON_NUMBER_ERROR,      /* not a JSON number */
+    JSON_NUMBER_INTEGER,    /* integral, and fits in an int64_t */
+    JSON_NUMBER_UNSIGNED,   /* integral, and fits only in a uint64_t */
+    JSON_NUMBER_REAL        /* has a fraction or exponent, or is too big */
+};
+
+/*
+    A JSON_number_struct receives the value of a number. real is always set to
+    the nearest double. integer is set for JSON_NUMBER_INTEGER, and unsigned_
+    integer for JSON_NUMBER_INTEGER when it is not negative and for
+    JSON_NUMBER_UNSIGNED.
+*/
+
+struct JSON_number_struct {
+    int type;
+    int64_t integer;
+    uint64_t unsigned_integer;
+    double real;
+};
+
+
+extern int JSON_number_decode(
+    const char* p,
+    size_t length,
+    struct JSON_number_struct* number
+);
+
+/*
+    Decode the text of a JSON number, such as a slice given to a JSON_handler's
+    number callback. It returns the type of the number, which is also stored in
+    number->type, or JSON_NUMBER_ERROR if the text is not exactly one JSON
+    number. Integers are exact, and reals are correctly rounded.
+*/
@@ -0,0 +1,516 @@
+/* JSON_tape.c */
+
+/* 2026-10-17 */
+
+/*
+Copyright (c) 2005 JSON.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+The Software shall be used for Good, not Evil.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "JSON_checker.h"
+#include "JSON_tape.h"
+
+#define TRUE  1
+#define FALSE 0
+
+/*
+    The tape is built from the events of a JSON_checker. The builder keeps a
+    stack of the indexes of the containers that are open, so that each can be
+    given its length and its next when it closes.
+*/
+
+struct builder {
+    JSON_tape tape;
+    uint32_t* open;
+    int top;
+    int size;
+};
+
+
+static int
+add_node(struct builder* b, int type)
+{
+/*
+    Append a node to the tape, and count it as a member or element of the
+    container that holds it. Return false if memory runs out.
+*/
+    JSON_tape tape = b->tape;
+    struct JSON_node* node;
+    struct JSON_node* parent;
+
+    if (tape->count == tape->capacity) {
+        size_t capacity = tape->capacity * 2;
+        struct JSON_node* bigger;
+        if (capacity > UINT32_MAX) {
+            return FALSE;
+        }
+        bigger = (struct JSON_node*)realloc(
+            tape->nodes,
+            capacity * sizeof(struct JSON_node)
+        );
+        if (bigger == NULL) {
+            return FALSE;
+        }
+        tape->nodes = bigger;
+        tape->capacity = capacity;
+    }
+    node = &tape->nodes[tape->count];
+    node->type = (uint32_t)type;
+    node->length = 0;
+    node->next = (uint32_t)(tape->count + 1);
+    node->text = 0;
+    tape->count += 1;
+    if (b->top >= 0 && type != JSON_TAPE_END) {
+        parent = &tape->nodes[b->open[b->top]];
+        if ((parent->type == JSON_TAPE_OBJECT) == (type == JSON_TAPE_KEY)) {
+            parent->length += 1;
+        }
+    }
+    return TRUE;
+}
+
+
+static int
+hex(int c)
+{
+    return (c <= '9')
+        ? c - '0'
+        : (c | 0x20) - 'a' + 10;
+}
+
+
+static char*
+put_utf8(char* out, unsigned long c)
+{
+    if (c < 0x80) {
+        *out++ = (char)c;
+    } else if (c < 0x800) {
+        *out++ = (char)(0xC0 | (c >> 6));
+        *out++ = (char)(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        *out++ = (char)(0xE0 | (c >> 12));
+        *out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (c & 0x3F));
+    } else {
+        *out++ = (char)(0xF0 | (c >> 18));
+        *out++ = (char)(0x80 | ((c >> 12) & 0x3F));
+        *out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (c & 0x3F));
+    }
+    return out;
+}
+
+
+static size_t
+unescape(char* out, const char* p, size_t length)
+{
+/*
+    Decode the raw text of a string, which the JSON_checker has already found
+    to be well formed, and return the length of the result. A surrogate pair
+    becomes one character. A surrogate that is not part of a pair becomes
+    U+FFFD. The result is never longer than the raw text.
+*/
+    const char* end = p + length;
+    const char* backslash;
+    char* start = out;
+    unsigned long c, low;
+
+    while (p < end) {
+        backslash = (const char*)memchr(p, '\\', (size_t)(end - p));
+        if (backslash == NULL) {
+            memcpy(out, p, (size_t)(end - p));
+            out += end - p;
+            break;
+        }
+        memcpy(out, p, (size_t)(backslash - p));
+        out += backslash - p;
+        p = backslash + 2;
+        switch (backslash[1]) {
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u':
+            c = (unsigned long)((hex(p[0]) << 12) | (hex(p[1]) << 8) |
+                    (hex(p[2]) << 4) | hex(p[3]));
+            p += 4;
+            if (c >= 0xD800 && c < 0xDC00 && end - p >= 6 && p[0] == '\\' &&
+                    p[1] == 'u') {
+                low = (unsigned long)((hex(p[2]) << 12) | (hex(p[3]) << 8) |
+                        (hex(p[4]) << 4) | hex(p[5]));
+                if (low >= 0xDC00 && low < 0xE000) {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+            }
+            if (c >= 0xD800 && c < 0xE000) {
+                c = 0xFFFD;
+            }
+            out = put_utf8(out, c);
+            break;
+        default:
+            *out++ = backslash[1];
+        }
+    }
+    return (size_t)(out - start);
+}
+
+
+static int
+add_text(struct builder* b, int type, const char* p, size_t length)
+{
+/*
+    Append a key, string, or number, with its text bumped onto the arena.
+*/
+    JSON_tape tape = b->tape;
+    struct JSON_node* node;
+    size_t size;
+    char* bigger;
+
+    if (!add_node(b, type)) {
+        return FALSE;
+    }
+    if (tape->used + length + 1 > tape->size) {
+        size = tape->size * 2;
+        while (size < tape->used + length + 1) {
+            size *= 2;
+        }
+        if (size - 1 > UINT32_MAX) {
+            return FALSE;
+        }
+        bigger = (char*)realloc(tape->arena, size);
+        if (bigger == NULL) {
+            return FALSE;
+        }
+        tape->arena = bigger;
+        tape->size = size;
+    }
+    node = &tape->nodes[tape->count - 1];
+    node->text = (uint32_t)tape->used;
+    if (type == JSON_TAPE_NUMBER) {
+        memcpy(tape->arena + tape->used, p, length);
+    } else {
+        length = unescape(tape->arena + tape->used, p, length);
+    }
+    node->length = (uint32_t)length;
+    tape->arena[tape->used + length] = 0;
+    tape->used += length + 1;
+    return TRUE;
+}
+
+
+static int
+begin(struct builder* b, int type)
+{
+    uint32_t* bigger;
+    if (b->top + 1 == b->size) {
+        bigger = (uint32_t*)realloc(b->open, b->size * 2 * sizeof(uint32_t));
+        if (bigger == NULL) {
+            return FALSE;
+        }
+        b->open = bigger;
+        b->size *= 2;
+    }
+    if (!add_node(b, type)) {
+        return FALSE;
+    }
+    b->top += 1;
+    b->open[b->top] = (uint32_t)(b->tape->count - 1);
+    return TRUE;
+}
+
+
+static int
+end(struct builder* b)
+{
+/*
+    Close the innermost container with an END node, and make its next point
+    past the END node.
+*/
+    if (!add_node(b, JSON_TAPE_END)) {
+        return FALSE;
+    }
+    b->tape->nodes[b->open[b->top]].next = (uint32_t)b->tape->count;
+    b->top -= 1;
+    return TRUE;
+}
+
+
+static int
+on_begin_object(void* context)
+{
+    return begin((struct builder*)context, JSON_TAPE_OBJECT);
+}
+
+
+static int
+on_begin_array(void* context)
+{
+    return begin((struct builder*)context, JSON_TAPE_ARRAY);
+}
+
+
+static int
+on_end(void* context)
+{
+    return end((struct builder*)context);
+}
+
+
+static int
+on_key(void* context, const char* p, size_t length)
+{
+    return add_text((struct builder*)context, JSON_TAPE_KEY, p, length);
+}
+
+
+static int
+on_string(void* context, const char* p, size_t length)
+{
+    return add_text((struct builder*)context, JSON_TAPE_STRING, p, length);
+}
+
+
+static int
+on_number(void* context, const char* p, size_t length)
+{
+    return add_text((struct builder*)context, JSON_TAPE_NUMBER, p, length);
+}
+
+
+static int
+on_boolean(void* context, int value)
+{
+    return add_node(
+        (struct builder*)context,
+        value
+            ? JSON_TAPE_TRUE
+            : JSON_TAPE_FALSE
+    );
+}
+
+
+static int
+on_null(void* context)
+{
+    return add_node((struct builder*)context, JSON_TAPE_NULL);
+}
+
+
+JSON_tape
+JSON_tape_parse(const char* p, size_t length, int depth, int options)
+{
+/*
+    Check the text with a JSON_checker whose handler builds the tape. The
+    tape and the arena are sized from the length of the text, so that a
+    typical text needs no growth.
+*/
+    struct JSON_checker_struct jc;
+    struct JSON_handler_struct handler;
+    struct builder b;
+    JSON_tape tape;
+    int ok;
+
+    tape = (JSON_tape)malloc(sizeof(struct JSON_tape_struct));
+    if (tape == NULL) {
+        return NULL;
+    }
+    tape->count = 0;
+    tape->capacity = length / 8 + 16;
+    tape->used = 0;
+    tape->size = length / 2 + 64;
+    tape->nodes = (struct JSON_node*)malloc(
+        tape->capacity * sizeof(struct JSON_node)
+    );
+    tape->arena = (char*)malloc(tape->size);
+    b.tape = tape;
+    b.top = -1;
+    b.size = 64;
+    b.open = (uint32_t*)malloc(b.size * sizeof(uint32_t));
+    if (tape->nodes == NULL || tape->arena == NULL || b.open == NULL ||
+            length > UINT32_MAX) {
+        free(b.open);
+        JSON_tape_free(tape);
+        return NULL;
+    }
+
+    handler.context = &b;
+    handler.begin_object = on_begin_object;
+    handler.end_object = on_end;
+    handler.begin_array = on_begin_array;
+    handler.end_array = on_end;
+    handler.key = on_key;
+    handler.string = on_string;
+    handler.number = on_number;
+    handler.boolean = on_boolean;
+    handler.null = on_null;
+
+    init_JSON_checker(&jc, depth);
+    JSON_checker_set_options(&jc, options);
+    JSON_checker_set_handler(&jc, &handler);
+    ok = JSON_checker_buffer(&jc, p, length) && JSON_checker_done(&jc);
+    JSON_checker_release(&jc);
+    free(b.open);
+    if (!ok) {
+        JSON_tape_free(tape);
+        return NULL;
+    }
+    return tape;
+}
+
+
+void
+JSON_tape_free(JSON_tape tape)
+{
+    if (tape != NULL) {
+        free((void*)tape->nodes);
+        free((void*)tape->arena);
+        free((void*)tape);
+    }
+}
+
+
+int
+JSON_tape_type(JSON_tape tape, size_t value)
+{
+    return (int)tape->nodes[value].type;
+}
+
+
+size_t
+JSON_tape_length(JSON_tape tape, size_t value)
+{
+    return tape->nodes[value].length;
+}
+
+
+const char*
+JSON_tape_text(JSON_tape tape, size_t value)
+{
+    return tape->arena + tape->nodes[value].text;
+}
+
+
+int
+JSON_tape_number(
+    JSON_tape tape,
+    size_t value,
+    struct JSON_number_struct* number
+)
+{
+    if (tape->nodes[value].type != JSON_TAPE_NUMBER) {
+        number->type = JSON_NUMBER_ERROR;
+        return JSON_NUMBER_ERROR;
+    }
+    return JSON_number_decode(
+        JSON_tape_text(tape, value),
+        tape->nodes[value].length,
+        number
+    );
+}
+
+
+size_t
+JSON_tape_first(JSON_tape tape, size_t container)
+{
+    if ((tape->nodes[container].type != JSON_TAPE_OBJECT &&
+            tape->nodes[container].type != JSON_TAPE_ARRAY) ||
+            tape->nodes[container + 1].type == JSON_TAPE_END) {
+        return JSON_TAPE_NONE;
+    }
+    return container + 1;
+}
+
+
+size_t
+JSON_tape_next(JSON_tape tape, size_t value)
+{
+/*
+    A key is skipped together with its value. The root has no next.
+*/
+    if (tape->nodes[value].type == JSON_TAPE_KEY) {
+        value += 1;
+    }
+    value = tape->nodes[value].next;
+    if (value >= tape->count || tape->nodes[value].type == JSON_TAPE_END) {
+        return JSON_TAPE_NONE;
+    }
+    return value;
+}
+
+
+size_t
+JSON_tape_get(JSON_tape tape, size_t object, const char* key)
+{
+/*
+    Search the keys of the object in order. Only the keys are examined; the
+    values are skipped with their next.
+*/
+    size_t length = strlen(key);
+    size_t member;
+
+    if (tape->nodes[object].type != JSON_TAPE_OBJECT) {
+        return JSON_TAPE_NONE;
+    }
+    for (
+        member = JSON_tape_first(tape, object);
+        member != JSON_TAPE_NONE;
+        member = JSON_tape_next(tape, member)
+    ) {
+        if (tape->nodes[member].length == length &&
+                memcmp(JSON_tape_text(tape, member), key, length) == 0) {
+            return member + 1;
+        }
+    }
+    return JSON_TAPE_NONE;
+}
+
+
+size_t
+JSON_tape_at(JSON_tape tape, size_t array, size_t position)
+{
+    size_t element;
+
+    if (tape->nodes[array].type != JSON_TAPE_ARRAY ||
+            position >= tape->nodes[array].length) {
+        return JSON_TAPE_NONE;
+    }
+    element = array + 1;
+    while (position > 0) {
+        element = tape->nodes[element].next;
+        position -= 1;
+    }
+    return element;
+}
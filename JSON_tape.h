@@ -0,0 +1,118 @@
+/* JSON_tape.h */
+
+/* 2026-10-17 */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "JSON_number.h"
+
+#define JSON_TAPE_NONE 0
+
+/*
+    The kinds of nodes on a tape.
+*/
+
+enum JSON_tape_types {
+    JSON_TAPE_END,
+    JSON_TAPE_OBJECT,
+    JSON_TAPE_ARRAY,
+    JSON_TAPE_KEY,
+    JSON_TAPE_STRING,
+    JSON_TAPE_NUMBER,
+    JSON_TAPE_TRUE,
+    JSON_TAPE_FALSE,
+    JSON_TAPE_NULL
+};
+
+/*
+    A tape holds a whole JSON text as one array of nodes, in the order of the
+    text. An object or array is followed by its contents and then by an END
+    node. The members of an object are a KEY node followed by the value.
+
+    Every node is 16 bytes. length is the number of members or elements of a
+    container, or the number of bytes of the text of a key, string, or number.
+    next is the index of the node that follows the value, so a whole container
+    can be skipped in one step. text is the offset of the text of a key,
+    string, or number in the arena.
+
+    The arena holds the text of all of the keys, strings, and numbers, one
+    after another. Strings and keys are decoded, with their escapes replaced by
+    UTF-8. Every text is followed by a NUL byte. A tape takes exactly two
+    allocations, which JSON_tape_free releases.
+*/
+
+struct JSON_node {
+    uint32_t type;
+    uint32_t length;
+    uint32_t next;
+    uint32_t text;
+};
+
+typedef struct JSON_tape_struct {
+    struct JSON_node* nodes;
+    size_t count;
+    size_t capacity;
+    char* arena;
+    size_t used;
+    size_t size;
+} * JSON_tape;
+
+
+extern JSON_tape JSON_tape_parse(
+    const char* p,
+    size_t length,
+    int depth,
+    int options
+);
+
+/*
+    Check a JSON text and load it onto a new tape. depth and options are as for
+    JSON_checker. It returns NULL if the text is rejected, or if memory runs
+    out. The text must be smaller than 4 GB.
+*/
+
+extern void JSON_tape_free(JSON_tape tape);
+
+/*
+    Free a tape and its arena in one call.
+*/
+
+extern int JSON_tape_type(JSON_tape tape, size_t value);
+extern size_t JSON_tape_length(JSON_tape tape, size_t value);
+extern const char* JSON_tape_text(JSON_tape tape, size_t value);
+
+/*
+    Values are named by their index on the tape. The root is at index 0.
+    JSON_tape_type gives the kind of a value. JSON_tape_length gives the number
+    of members or elements of a container, or the length in bytes of the text
+    of a key, string, or number. JSON_tape_text gives that text.
+*/
+
+extern int JSON_tape_number(
+    JSON_tape tape,
+    size_t value,
+    struct JSON_number_struct* number
+);
+
+/*
+    Decode a NUMBER node with JSON_number_decode. It returns the type of the
+    number, or JSON_NUMBER_ERROR if the value is not a number.
+*/
+
+extern size_t JSON_tape_first(JSON_tape tape, size_t container);
+extern size_t JSON_tape_next(JSON_tape tape, size_t value);
+
+/*
+    Iterate the contents of a container. JSON_tape_first gives the first
+    element of an array or the first key of an object. JSON_tape_next gives the
+    one after a value or a key's value. In an object the value of a key is at
+    the key's index plus one. Both return JSON_TAPE_NONE at the end.
+*/
+
+extern size_t JSON_tape_get(JSON_tape tape, size_t object, const char* key);
+extern size_t JSON_tape_at(JSON_tape tape, size_t array, size_t position);
+
+/*
+    Look up the value of a key in an object, or an element of an array by its
+    position. They return JSON_TAPE_NONE if there is no such value.
+*/
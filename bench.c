@@ -0,0 +1,559 @@
+/* bench.c */
+
+/*
+    This program measures the speed of JSON_checker and of the UTF-8
+    accessories, so that a change to one of their inner loops can be judged
+    by numbers instead of by guesswork. Build it with optimization, and with
+    the same compiler and flags as the program that the code will go into.
+
+        % cc -O2 -pthread -o bench bench.c JSON_checker.c utf8_decode.c \
+              utf8_to_utf16.c
+        % ./bench >results.json
+
+    It generates a set of corpora from a fixed seed, so every run on every
+    machine sees exactly the same bytes:
+
+        nested      objects and arrays nested a thousand deep
+        numbers     integers, fractions, and exponents
+        strings     ASCII strings with some escapes
+        whitespace  pretty printed objects with deep indentation
+        unicode     strings of 2, 3, and 4 byte UTF-8 sequences
+        tiny        many small documents, each checked on its own
+
+    Each function is run on each corpus until at least a quarter of a second
+    has gone by, and the fastest run is reported. The results are written to
+    STDOUT as a JSON text, in MB/s and ns per document. On Linux the cycles,
+    instructions, and branch misses of a run are counted with perf_event_open
+    where the kernel allows it. Otherwise they are null.
+
+    The options are:
+
+        -s megabytes    the size of each corpus (default 8)
+        -c corpus       run only the named corpus
+        -f function     run only the named function
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "JSON_checker.h"
+#include "utf8_decode.h"
+#include "utf8_to_utf16.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define DEPTH 100000
+#define NESTING 1000
+#define MIN_TIME 0.25
+#define NR_COUNTERS 3
+
+/*
+    A corpus is a buffer of text, cut into one or more documents. Only the
+    tiny corpus has more than one.
+*/
+
+struct corpus {
+    const char* name;
+    char* text;
+    size_t length;
+    size_t capacity;
+    size_t* starts;
+    long count;
+    long allocated;
+};
+
+
+static uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t random_below(uint32_t limit) {
+/*
+    xorshift64*, which is fast and gives the same numbers everywhere.
+*/
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return (uint32_t)((seed * 0x2545F4914F6CDD1DULL) >> 32) % limit;
+}
+
+
+static void put(struct corpus* c, const char* p, size_t length) {
+    if (c->length + length > c->capacity) {
+        c->capacity = (c->capacity + length) * 2;
+        c->text = (char*)realloc(c->text, c->capacity);
+        if (c->text == NULL) {
+            fprintf(stderr, "bench: out of memory\n");
+            exit(1);
+        }
+    }
+    memcpy(c->text + c->length, p, length);
+    c->length += length;
+}
+
+
+static void put_text(struct corpus* c, const char* s) {
+    put(c, s, strlen(s));
+}
+
+
+static void begin_document(struct corpus* c) {
+    if (c->count == c->allocated) {
+        c->allocated = c->allocated ? c->allocated * 2 : 1024;
+        c->starts = (size_t*)realloc(
+            c->starts,
+            (c->allocated + 1) * sizeof(size_t)
+        );
+        if (c->starts == NULL) {
+            fprintf(stderr, "bench: out of memory\n");
+            exit(1);
+        }
+    }
+    c->starts[c->count] = c->length;
+    c->count += 1;
+}
+
+
+static void end_document(struct corpus* c) {
+    c->starts[c->count] = c->length;
+}
+
+
+static void put_number(struct corpus* c) {
+    char buffer[64];
+    switch (random_below(4)) {
+    case 0:
+        sprintf(buffer, "%u", random_below(1000));
+        break;
+    case 1:
+        sprintf(buffer, "-%u%05u", random_below(100000), random_below(100000));
+        break;
+    case 2:
+        sprintf(buffer, "%u.%06u", random_below(10000), random_below(1000000));
+        break;
+    default:
+        sprintf(buffer, "%u.%ue%s%u", random_below(10), random_below(100000),
+                random_below(2) ? "-" : "+", random_below(300));
+    }
+    put_text(c, buffer);
+}
+
+
+static void put_string(struct corpus* c) {
+    static const char* escapes[] = {"\\n", "\\\"", "\\\\", "\\u00e9", "\\t"};
+    uint32_t length = random_below(64);
+    uint32_t i;
+    char ch;
+
+    put_text(c, "\"");
+    for (i = 0; i < length; i += 1) {
+        if (random_below(32) == 0) {
+            put_text(c, escapes[random_below(5)]);
+        } else {
+            ch = (char)('a' + random_below(26));
+            put(c, &ch, 1);
+        }
+    }
+    put_text(c, "\"");
+}
+
+
+static void put_unicode(struct corpus* c) {
+/*
+    Strings of Greek, CJK, and emoji, in roughly equal measure.
+*/
+    static const char* samples[] = {
+        "\xce\xb1", "\xce\xb2", "\xce\xbb", "\xcf\x89",
+        "\xe4\xb8\xad", "\xe6\x96\x87", "\xe3\x81\x82", "\xea\xb0\x80",
+        "\xf0\x9f\x98\x80", "\xf0\x9f\x8c\x8d", "\xf0\x9d\x84\x9e", " "
+    };
+    uint32_t length = 1 + random_below(32);
+    uint32_t i;
+
+    put_text(c, "\"");
+    for (i = 0; i < length; i += 1) {
+        put_text(c, samples[random_below(12)]);
+    }
+    put_text(c, "\"");
+}
+
+
+static void put_indent(struct corpus* c, int level) {
+    int i;
+    put_text(c, "\n");
+    for (i = 0; i < level; i += 1) {
+        put_text(c, "    ");
+    }
+}
+
+
+static void put_pretty(struct corpus* c, int level) {
+/*
+    A pretty printed object, mostly indentation.
+*/
+    int i;
+    put_text(c, "{");
+    for (i = 0; i < 3; i += 1) {
+        put_indent(c, level + 1);
+        put_text(c, "\"k\" : ");
+        if (level < 8 && random_below(2)) {
+            put_pretty(c, level + 1);
+        } else {
+            put_number(c);
+        }
+        if (i < 2) {
+            put_text(c, ",");
+        }
+    }
+    put_indent(c, level);
+    put_text(c, "}");
+}
+
+
+static void generate(struct corpus* c, size_t size) {
+    int i;
+
+    seed = 0x9E3779B97F4A7C15ULL;
+    if (strcmp(c->name, "tiny") == 0) {
+        while (c->length < size) {
+            begin_document(c);
+            switch (random_below(3)) {
+            case 0:
+                put_text(c, "{\"id\":");
+                put_number(c);
+                put_text(c, ",\"ok\":true}");
+                break;
+            case 1:
+                put_text(c, "[");
+                put_number(c);
+                put_text(c, ",");
+                put_string(c);
+                put_text(c, "]");
+                break;
+            default:
+                put_text(c, "{}");
+            }
+            end_document(c);
+        }
+        return;
+    }
+    begin_document(c);
+    put_text(c, "[");
+    while (c->length < size) {
+        if (c->length > 1) {
+            put_text(c, ",");
+        }
+        if (strcmp(c->name, "nested") == 0) {
+            for (i = 0; i < NESTING; i += 1) {
+                put_text(c, (i & 1) ? "[" : "{\"a\":");
+            }
+            put_number(c);
+            for (i = NESTING - 1; i >= 0; i -= 1) {
+                put_text(c, (i & 1) ? "]" : "}");
+            }
+        } else if (strcmp(c->name, "numbers") == 0) {
+            put_number(c);
+        } else if (strcmp(c->name, "strings") == 0) {
+            put_string(c);
+        } else if (strcmp(c->name, "whitespace") == 0) {
+            put_pretty(c, 0);
+        } else {
+            put_unicode(c);
+        }
+    }
+    put_text(c, "]");
+    end_document(c);
+}
+
+
+/*
+    Each function checks or decodes one document, and returns nonzero if it
+    did so without error. The sink keeps the compiler from discarding work
+    whose result is otherwise unused.
+*/
+
+static struct JSON_checker_struct the_checker;
+static unsigned short* utf16;
+static volatile long sink;
+
+static int run_char(const char* p, size_t length) {
+    size_t i;
+    JSON_checker_reset(&the_checker);
+    for (i = 0; i < length; i += 1) {
+        if (!JSON_checker_char(&the_checker, (unsigned char)p[i])) {
+            return 0;
+        }
+    }
+    return JSON_checker_done(&the_checker);
+}
+
+
+static int run_buffer(const char* p, size_t length) {
+    JSON_checker_reset(&the_checker);
+    return JSON_checker_buffer(&the_checker, p, length)
+        && JSON_checker_done(&the_checker);
+}
+
+
+static int run_decode(const char* p, size_t length) {
+    int c;
+    long n = 0;
+    utf8_decode_init((char*)p, (int)length);
+    while ((c = utf8_decode_next()) >= 0) {
+        n += c;
+    }
+    sink = n;
+    return c == UTF8_END;
+}
+
+
+static int run_to_utf16(const char* p, size_t length) {
+    return utf8_to_utf16(utf16, (char*)p, (int)length) >= 0;
+}
+
+
+static int run_validate(const char* p, size_t length) {
+    return utf8_validate(p, length) == length;
+}
+
+
+static const struct {
+    const char* name;
+    int (*run)(const char* p, size_t length);
+} functions[] = {
+    {"JSON_checker_char", run_char},
+    {"JSON_checker_buffer", run_buffer},
+    {"utf8_decode_next", run_decode},
+    {"utf8_to_utf16", run_to_utf16},
+    {"utf8_validate", run_validate}
+};
+
+#define NR_FUNCTIONS (sizeof(functions) / sizeof(functions[0]))
+
+
+/*
+    The hardware counters are opened once, as a group, and are read around
+    each run. If the kernel will not give them to us, they stay closed.
+*/
+
+static int counters[NR_COUNTERS] = {-1, -1, -1};
+
+static void open_counters(void) {
+#if defined(__linux__)
+    static const unsigned long long configs[NR_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    struct perf_event_attr attr;
+    int i;
+
+    for (i = 0; i < NR_COUNTERS; i += 1) {
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        counters[i] = (int)syscall(
+            __NR_perf_event_open,
+            &attr,
+            0,
+            -1,
+            i == 0 ? -1 : counters[0],
+            0
+        );
+        if (counters[i] < 0) {
+            while (i >= 0) {
+                if (counters[i] >= 0) {
+                    close(counters[i]);
+                }
+                counters[i] = -1;
+                i -= 1;
+            }
+            return;
+        }
+    }
+#endif
+}
+
+
+static int read_counters(uint64_t values[NR_COUNTERS]) {
+/*
+    Read the group: the number of counters, then each value.
+*/
+#if defined(__linux__)
+    uint64_t group[1 + NR_COUNTERS];
+    if (counters[0] >= 0 &&
+            read(counters[0], group, sizeof(group)) == sizeof(group)) {
+        memcpy(values, group + 1, sizeof(uint64_t) * NR_COUNTERS);
+        return 1;
+    }
+#endif
+    (void)values;
+    return 0;
+}
+
+
+static void enable_counters(int on) {
+#if defined(__linux__)
+    if (counters[0] >= 0) {
+        ioctl(
+            counters[0],
+            on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE,
+            PERF_IOC_FLAG_GROUP
+        );
+    }
+#endif
+    (void)on;
+}
+
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+
+static int measure(
+    struct corpus* c,
+    int (*run)(const char* p, size_t length),
+    double* best,
+    uint64_t counts[NR_COUNTERS],
+    int* counted
+) {
+/*
+    Run a function over every document of a corpus, again and again, until
+    enough time has gone by. Keep the fastest run, and the counts of that run.
+*/
+    double began = now();
+    double start, elapsed;
+    uint64_t before[NR_COUNTERS], after[NR_COUNTERS];
+    int have;
+    int ok = 1;
+    long d;
+    int i;
+
+    *best = 0;
+    *counted = 0;
+    do {
+        enable_counters(1);
+        have = read_counters(before);
+        start = now();
+        for (d = 0; d < c->count; d += 1) {
+            ok &= run(c->text + c->starts[d], c->starts[d + 1] - c->starts[d]);
+        }
+        elapsed = now() - start;
+        have = read_counters(after) && have;
+        enable_counters(0);
+        if (*best == 0 || elapsed < *best) {
+            *best = elapsed;
+            *counted = have;
+            for (i = 0; i < NR_COUNTERS && have; i += 1) {
+                counts[i] = after[i] - before[i];
+            }
+        }
+    } while (now() - began < MIN_TIME);
+    return ok;
+}
+
+
+int main(int argc, char* argv[]) {
+    static const char* names[] = {
+        "nested", "numbers", "strings", "whitespace", "unicode", "tiny"
+    };
+    const char* only_corpus = NULL;
+    const char* only_function = NULL;
+    size_t size = 8;
+    const char* separator = "";
+    struct corpus c;
+    double best;
+    uint64_t counts[NR_COUNTERS];
+    int counted;
+    int ok;
+    size_t n, f;
+    int i;
+
+    for (i = 1; i < argc; i += 1) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            i += 1;
+            size = (size_t)atol(argv[i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            i += 1;
+            only_corpus = argv[i];
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            i += 1;
+            only_function = argv[i];
+        } else {
+            fprintf(stderr,
+                    "usage: bench [-s megabytes] [-c corpus] [-f function]\n");
+            exit(2);
+        }
+    }
+    if (size < 1 || size > 1024) {
+        fprintf(stderr, "bench: the size must be from 1 to 1024 megabytes\n");
+        exit(2);
+    }
+    size *= 1024 * 1024;
+    init_JSON_checker(&the_checker, DEPTH);
+    utf16 = (unsigned short*)malloc((size + 1024) * 2 * sizeof(unsigned short));
+    if (utf16 == NULL) {
+        fprintf(stderr, "bench: out of memory\n");
+        exit(1);
+    }
+    open_counters();
+    printf("{\n    \"corpus_size\": %lu,\n    \"counters\": %s,\n"
+            "    \"results\": [", (unsigned long)size,
+            counters[0] >= 0 ? "true" : "false");
+    for (n = 0; n < sizeof(names) / sizeof(names[0]); n += 1) {
+        if (only_corpus != NULL && strcmp(only_corpus, names[n]) != 0) {
+            continue;
+        }
+        memset(&c, 0, sizeof(c));
+        c.name = names[n];
+        generate(&c, size);
+        for (f = 0; f < NR_FUNCTIONS; f += 1) {
+            if (only_function != NULL &&
+                    strcmp(only_function, functions[f].name) != 0) {
+                continue;
+            }
+            ok = measure(&c, functions[f].run, &best, counts, &counted);
+            printf("%s\n        {\"corpus\": \"%s\", \"function\": \"%s\", "
+                    "\"bytes\": %lu, \"documents\": %ld, \"ok\": %s, "
+                    "\"seconds\": %.9f, \"mb_per_s\": %.2f, "
+                    "\"ns_per_document\": %.1f, ",
+                    separator, c.name, functions[f].name,
+                    (unsigned long)c.length, c.count, ok ? "true" : "false",
+                    best, (double)c.length / best / 1e6,
+                    best * 1e9 / (double)c.count);
+            if (counted) {
+                printf("\"cycles\": %llu, \"instructions\": %llu, "
+                        "\"branch_misses\": %llu}",
+                        (unsigned long long)counts[0],
+                        (unsigned long long)counts[1],
+                        (unsigned long long)counts[2]);
+            } else {
+                printf("\"cycles\": null, \"instructions\": null, "
+                        "\"branch_misses\": null}");
+            }
+            separator = ",";
+            fflush(stdout);
+        }
+        free(c.text);
+        free(c.starts);
+    }
+    printf("\n    ]\n}\n");
+    JSON_checker_release(&the_checker);
+    free(utf16);
+    return 0;
+}
@@ -5,31 +5,741 @@
     a JSON text from STDIN, producing an error message if the text is rejected.
 
         % JSON_checker <test/pass1.json
+
+    It can also be given files, each of which is checked as a separate JSON
+    text. A regular file is mapped into memory and checked in place, using
+    several threads if it is large. Anything else is read in large blocks.
+    The maximum depth of nesting can be given with -d.
+
+        % JSON_checker -d 64 test/pass1.json test/pass2.json
+
+    With the -l option, it reads newline-delimited JSON (JSON Lines) instead.
+    Every line is checked as a separate JSON text. The line number of each
+    rejected line is reported, and a summary is printed at the end. Blank lines
+    are skipped. The lines are checked by a pool of threads, whose number can
+    be given with -t. The reports still come out in the order of the input.
+
+        % JSON_checker -l -t 8 <audit.ndjson
+
+    With the -m option, each text that is accepted is also written to STDOUT
+    without the whitespace between its tokens, followed by a linefeed. The
+    text is checked and minified in the same pass. Nothing is written for a
+    text that is rejected.
+
+        % JSON_checker -m <pretty.json >small.json
+
+    With the -c option, each file is taken to be a text that only grows, such
+    as an array to which records are appended. The place where the checking
+    stopped is saved in a checkpoint file next to it, with .checkpoint added
+    to its name. The next run restores the checkpoint and checks only the
+    bytes that have been appended since. The last 4096 bytes before that
+    place are fingerprinted, so a file that was truncated, or rewritten within
+    those 4096 bytes, is checked again from the start. A change to anything
+    before them goes unnoticed. It reports whether the text is complete.
+
+        % JSON_checker -c audit.json
+
+    With the -s option, a profile of each text is written to STDOUT as a JSON
+    text: how many bytes were in strings, numbers, literals, whitespace, and
+    structure, how many of each action, and so on. This needs a JSON_checker.c
+    compiled with JSON_CHECKER_STATS.
+
+        % cc -DJSON_CHECKER_STATS -O2 -pthread -o JSON_checker main.c JSON_checker.c
+        % JSON_checker -s traffic.json
 */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "JSON_checker.h"
 
-int main(int argc, char* argv[]) {
+#define DEPTH 20
+#define BLOCK_SIZE (16 * 1024 * 1024)
+#define READ_SIZE (1024 * 1024)
+#define PAGE_SIZE 4096
+#define CLAIM 64
+#define FINGERPRINT_SIZE 4096
+
+static int depth = DEPTH;
+static int minified = 0;
+static int appended = 0;
+static int profiled = 0;
+
+/*
+    A record is one line of the input. Its result, and its error if it is
+    rejected, are filled in by a worker.
+*/
+
+struct record {
+    const char* text;
+    size_t length;
+    long line;
+    int result;
+    struct JSON_error_struct error;
+};
+
+
 /*
-    Read STDIN. Exit with a message if the input is not well-formed JSON text.
+    The pool holds the batch of records that the workers are checking. The
+    main thread publishes a batch by bumping generation, and waits until
+    finished reaches count.
+*/
 
-    jc will contain a JSON_checker with a maximum depth of 20.
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    struct record* records;
+    long count;
+    long next;
+    long finished;
+    long generation;
+    int quit;
+} pool = {
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    NULL,
+    0,
+    0,
+    0,
+    0,
+    0
+};
+
+
+static void* worker(void* unused) {
+/*
+    Each worker keeps one JSON_checker for its whole life, and resets it for
+    each record, so checking a record allocates nothing.
 */
-    JSON_checker jc = new_JSON_checker(20);
+    struct JSON_checker_struct jc;
+    long generation = 0;
+    long first, last, i;
+
+    init_JSON_checker(&jc, depth);
+    pthread_mutex_lock(&pool.lock);
     for (;;) {
-        int next_char = getchar();
-        if (next_char <= 0) {
+        while (!pool.quit && pool.generation == generation) {
+            pthread_cond_wait(&pool.work, &pool.lock);
+        }
+        if (pool.quit) {
             break;
         }
-        if (!JSON_checker_char(jc, next_char)) {
-            fprintf(stderr, "JSON_checker_char: syntax error\n");
-            exit(1);
+        generation = pool.generation;
+/*
+    Claim records a few at a time until the batch is used up.
+*/
+        while (pool.next < pool.count) {
+            first = pool.next;
+            last = first + CLAIM < pool.count ? first + CLAIM : pool.count;
+            pool.next = last;
+            pthread_mutex_unlock(&pool.lock);
+            for (i = first; i < last; i += 1) {
+                JSON_checker_reset(&jc);
+                JSON_checker_set_error(&jc, &pool.records[i].error);
+                pool.records[i].result = JSON_checker_buffer(
+                    &jc,
+                    pool.records[i].text,
+                    pool.records[i].length
+                ) && JSON_checker_done(&jc);
+            }
+            pthread_mutex_lock(&pool.lock);
+            pool.finished += last - first;
+            if (pool.finished == pool.count) {
+                pthread_cond_signal(&pool.done);
+            }
+        }
+    }
+    pthread_mutex_unlock(&pool.lock);
+    JSON_checker_release(&jc);
+    return unused;
+}
+
+
+static void check_batch(struct record* records, long count) {
+/*
+    Hand a batch to the workers and wait for all of it to be checked.
+*/
+    pthread_mutex_lock(&pool.lock);
+    pool.records = records;
+    pool.count = count;
+    pool.next = 0;
+    pool.finished = 0;
+    pool.generation += 1;
+    pthread_cond_broadcast(&pool.work);
+    while (pool.finished < count) {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+}
+
+
+static void report(const char* name, JSON_error error) {
+/*
+    Say where and why a text was rejected. The line and column are given if
+    they are known, otherwise the byte offset.
+*/
+    if (error->line > 0) {
+        fprintf(stderr, "%s:%lu:%lu: ", name, (unsigned long)error->line,
+                (unsigned long)error->column);
+    } else {
+        fprintf(stderr, "%s: byte %lu: ", name, (unsigned long)error->offset);
+    }
+    if (error->character == -2) {
+        fprintf(stderr, "out of memory\n");
+        return;
+    }
+    fprintf(stderr, "syntax error: unexpected %s in %s (depth %d)\n",
+            error->character_class, error->state, error->depth);
+}
+
+
+static int is_blank(const char* p, size_t length) {
+    size_t i;
+    for (i = 0; i < length; i += 1) {
+        if (p[i] != ' ' && p[i] != '\t' && p[i] != '\r') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+static ssize_t read_block(int fd, char* p, size_t size) {
+/*
+    Read up to size bytes, retrying if interrupted. Return 0 at the end of the
+    input, and -1 if there is an error.
+*/
+    ssize_t got;
+    do {
+        got = read(fd, p, size);
+    } while (got < 0 && errno == EINTR);
+    return got;
+}
+
+
+static int check_lines(int fd, const char* name, int threads) {
+/*
+    Read the input a large block at a time. Cut each block into lines with
+    memchr, which scans many bytes at a time, and check the complete lines as a
+    batch. A partial line at the end of a block is carried over to the next
+    block.
+*/
+    size_t size = BLOCK_SIZE;
+    char* block = (char*)malloc(size);
+    size_t have = 0;
+    size_t capacity = 0;
+    struct record* records = NULL;
+    pthread_t* tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    long line = 0;
+    long passed = 0;
+    long failed = 0;
+    int at_end = 0;
+    int t;
+
+    if (block == NULL || tids == NULL) {
+        fprintf(stderr, "JSON_checker: out of memory\n");
+        exit(1);
+    }
+    pool.quit = 0;
+    for (t = 0; t < threads; t += 1) {
+        if (pthread_create(&tids[t], NULL, worker, NULL) != 0) {
+            break;
+        }
+    }
+/*
+    Go on with the workers that did start. Without any, nothing would check
+    the batches.
+*/
+    if (t == 0) {
+        fprintf(stderr, "JSON_checker: can not start a thread\n");
+        exit(1);
+    }
+    threads = t;
+    while (!at_end) {
+        ssize_t got;
+        size_t start, length;
+        long count = 0;
+        long i;
+        const char* newline;
+
+        if (have == size) {
+            size *= 2;
+            block = (char*)realloc(block, size);
+            if (block == NULL) {
+                fprintf(stderr, "JSON_checker: out of memory\n");
+                exit(1);
+            }
+        }
+        got = read_block(fd, block + have, size - have);
+        if (got < 0) {
+            fprintf(stderr, "JSON_checker: %s: %s\n", name, strerror(errno));
+            failed += 1;
+            got = 0;
+        }
+        have += got;
+        at_end = got == 0;
+        start = 0;
+        for (;;) {
+            newline = (const char*)memchr(block + start, '\n', have - start);
+            if (newline == NULL) {
+                if (!at_end || start == have) {
+                    break;
+                }
+                length = have - start;
+            } else {
+                length = newline - (block + start);
+            }
+            line += 1;
+            if (!is_blank(block + start, length)) {
+                if ((size_t)count == capacity) {
+                    capacity = capacity ? capacity * 2 : 4096;
+                    records = (struct record*)realloc(
+                        records,
+                        capacity * sizeof(struct record)
+                    );
+                    if (records == NULL) {
+                        fprintf(stderr, "JSON_checker: out of memory\n");
+                        exit(1);
+                    }
+                }
+                records[count].text = block + start;
+                records[count].length = length;
+                records[count].line = line;
+                count += 1;
+            }
+            start += length + (newline != NULL);
+        }
+        check_batch(records, count);
+        for (i = 0; i < count; i += 1) {
+            if (records[i].result) {
+                passed += 1;
+            } else {
+                failed += 1;
+                records[i].error.line = (size_t)records[i].line;
+                records[i].error.column = records[i].error.offset + 1;
+                report(name, &records[i].error);
+            }
+        }
+        memmove(block, block + start, have - start);
+        have -= start;
+    }
+    pthread_mutex_lock(&pool.lock);
+    pool.quit = 1;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+    for (t = 0; t < threads; t += 1) {
+        pthread_join(tids[t], NULL);
+    }
+    printf("%s: %ld records, %ld passed, %ld failed\n", name, passed + failed,
+            passed, failed);
+    free(records);
+    free(block);
+    free(tids);
+    return failed == 0;
+}
+
+
+static void print_stats(const char* name, JSON_stats stats) {
+/*
+    Write a profile as a JSON text. The name is written as it is, so it should
+    not need escapes.
+*/
+    printf("{\"file\": \"%s\", \"bytes\": {\"string\": %lu, \"number\": %lu, "
+            "\"literal\": %lu, \"white\": %lu, \"structure\": %lu}, ", name,
+            (unsigned long)stats->string_bytes,
+            (unsigned long)stats->number_bytes,
+            (unsigned long)stats->literal_bytes,
+            (unsigned long)stats->white_bytes,
+            (unsigned long)stats->structure_bytes);
+    printf("\"actions\": {\"colon\": %lu, \"comma\": %lu, \"quote\": %lu, "
+            "\"begin_array\": %lu, \"begin_object\": %lu, \"end_array\": %lu, "
+            "\"end_object\": %lu, \"empty_object\": %lu}, ",
+            (unsigned long)stats->actions[2], (unsigned long)stats->actions[3],
+            (unsigned long)stats->actions[4], (unsigned long)stats->actions[5],
+            (unsigned long)stats->actions[6], (unsigned long)stats->actions[7],
+            (unsigned long)stats->actions[8], (unsigned long)stats->actions[9]);
+    printf("\"escapes\": %lu, \"unicode_escapes\": %lu, \"longest_string\": %lu, "
+            "\"longest_number\": %lu, \"max_depth\": %d}\n",
+            (unsigned long)stats->escapes,
+            (unsigned long)stats->unicode_escapes,
+            (unsigned long)stats->longest_string,
+            (unsigned long)stats->longest_number, stats->max_depth);
+}
+
+
+static int check_text(
+    JSON_checker jc,
+    int fd,
+    const char* name,
+    int threads
+) {
+/*
+    Check the input as a single JSON text. A regular file is mapped into
+    memory, so the checker reads it straight from the page cache. Pipes and
+    terminals are read in large, page aligned blocks. Either way the bytes are
+    given to the checker in bulk, and a NUL byte is just another byte, which
+    the checker rejects.
+
+    The line and column of an error are only worked out for a mapped file,
+    which is still at hand. Blocks that have been read are gone, so the byte
+    offset is reported instead.
+*/
+    struct stat info;
+    struct JSON_error_struct error;
+    struct JSON_minify_struct minify = {NULL, 0, 0};
+    struct JSON_stats_struct stats;
+    char* block;
+    ssize_t got;
+    int ok = 1;
+
+    JSON_checker_reset(jc);
+    JSON_checker_set_error(jc, &error);
+    if (minified) {
+        JSON_checker_set_minify(jc, &minify);
+    }
+    if (profiled) {
+        memset(&stats, 0, sizeof(stats));
+        JSON_checker_set_stats(jc, &stats);
+    }
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = (size_t)info.st_size;
+        char* p = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            posix_madvise(p, size, POSIX_MADV_SEQUENTIAL);
+            ok = JSON_checker_parallel(jc, p, size, threads)
+                && JSON_checker_done(jc);
+            if (!ok) {
+                JSON_error_locate(&error, p, size);
+            }
+            munmap(p, size);
+            goto done;
         }
     }
-    if (!JSON_checker_done(jc)) {
-        fprintf(stderr, "JSON_checker_end: syntax error\n");
+    if (posix_memalign((void**)&block, PAGE_SIZE, READ_SIZE) != 0) {
+        fprintf(stderr, "JSON_checker: out of memory\n");
         exit(1);
     }
-}
\ No newline at end of file
+    for (;;) {
+        got = read_block(fd, block, READ_SIZE);
+        if (got < 0) {
+            fprintf(stderr, "JSON_checker: %s: %s\n", name, strerror(errno));
+            free(block);
+            free(minify.bytes);
+            JSON_checker_set_error(jc, NULL);
+            JSON_checker_set_minify(jc, NULL);
+            JSON_checker_set_stats(jc, NULL);
+            return 0;
+        }
+        if (got == 0) {
+            break;
+        }
+        if (!JSON_checker_buffer(jc, block, (size_t)got)) {
+            ok = 0;
+            break;
+        }
+    }
+    free(block);
+    ok = ok && JSON_checker_done(jc);
+done:
+    JSON_checker_set_error(jc, NULL);
+    JSON_checker_set_minify(jc, NULL);
+    JSON_checker_set_stats(jc, NULL);
+    if (!ok) {
+        report(name, &error);
+    } else if (minified) {
+        fwrite(minify.bytes, 1, minify.length, stdout);
+        putchar('\n');
+    } else if (profiled) {
+        print_stats(name, &stats);
+    }
+    free(minify.bytes);
+    return ok;
+}
+
+
+static uint64_t fingerprint(const char* text, size_t offset) {
+/*
+    Hash the bytes just before offset with 64-bit FNV-1a.
+*/
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i = offset > FINGERPRINT_SIZE ? offset - FINGERPRINT_SIZE : 0;
+    for (; i < offset; i += 1) {
+        hash = (hash ^ (unsigned char)text[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+static char* read_checkpoint(const char* path, size_t* length) {
+/*
+    Read a whole checkpoint file, or return NULL if there is none.
+*/
+    struct stat info;
+    char* p;
+    ssize_t got;
+    size_t have = 0;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &info) != 0 || info.st_size < 8 ||
+            (p = (char*)malloc((size_t)info.st_size)) == NULL) {
+        close(fd);
+        return NULL;
+    }
+    while (have < (size_t)info.st_size) {
+        got = read_block(fd, p + have, (size_t)info.st_size - have);
+        if (got <= 0) {
+            break;
+        }
+        have += (size_t)got;
+    }
+    close(fd);
+    if (have != (size_t)info.st_size) {
+        free(p);
+        return NULL;
+    }
+    *length = have;
+    return p;
+}
+
+
+static int write_checkpoint(const char* path, const char* p, size_t length) {
+/*
+    Write a checkpoint file whole, by way of a temporary file that is renamed
+    over it, so that a crash leaves either the old one or the new one.
+*/
+    size_t size = strlen(path) + 5;
+    char* temporary = (char*)malloc(size);
+    size_t done = 0;
+    ssize_t put;
+    int fd;
+
+    if (temporary == NULL) {
+        return 0;
+    }
+    snprintf(temporary, size, "%s.tmp", path);
+    fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(temporary);
+        return 0;
+    }
+    while (done < length) {
+        put = write(fd, p + done, length - done);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put <= 0) {
+            break;
+        }
+        done += (size_t)put;
+    }
+    if (close(fd) != 0 || done != length || rename(temporary, path) != 0) {
+        unlink(temporary);
+        free(temporary);
+        return 0;
+    }
+    free(temporary);
+    return 1;
+}
+
+
+static int check_appended(
+    JSON_checker jc,
+    int fd,
+    const char* name,
+    int threads
+) {
+/*
+    Check what has been appended to a file since its checkpoint was saved.
+    The checkpoint file holds the fingerprint, in 8 bytes, and then the blob
+    from JSON_checker_save. The offset in the blob is the length of the file
+    that has been checked. If the text is still right, a new checkpoint is
+    saved at its end. If it is not, the old checkpoint is left alone.
+
+    The whole file is mapped, but only the new pages are read, unless there is
+    an error to locate.
+*/
+    struct stat info;
+    struct JSON_error_struct error;
+    size_t size = strlen(name) + sizeof(".checkpoint");
+    char* path = (char*)malloc(size);
+    char* saved;
+    char* text = NULL;
+    size_t length;
+    size_t offset = 0;
+    uint64_t hash;
+    int ok = 1;
+    int i;
+
+    if (path == NULL) {
+        fprintf(stderr, "JSON_checker: out of memory\n");
+        exit(1);
+    }
+    snprintf(path, size, "%s.checkpoint", name);
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        fprintf(stderr, "JSON_checker: %s: -c needs a regular file\n", name);
+        free(path);
+        return 0;
+    }
+    size = (size_t)info.st_size;
+    if (size > 0) {
+        text = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text == MAP_FAILED) {
+            fprintf(stderr, "JSON_checker: %s: %s\n", name, strerror(errno));
+            free(path);
+            return 0;
+        }
+    }
+    JSON_checker_reset(jc);
+    JSON_checker_set_error(jc, &error);
+    saved = read_checkpoint(path, &length);
+    if (saved != NULL) {
+        hash = 0;
+        for (i = 7; i >= 0; i -= 1) {
+            hash = hash << 8 | (unsigned char)saved[i];
+        }
+        if (JSON_checker_restore(jc, saved + 8, length - 8) &&
+                jc->offset <= size && fingerprint(text, jc->offset) == hash) {
+            offset = jc->offset;
+        } else {
+            fprintf(stderr, "JSON_checker: %s: the checkpoint does not match; "
+                    "checking from the start\n", name);
+            JSON_checker_reset(jc);
+        }
+        free(saved);
+    }
+    if (size > offset) {
+        posix_madvise(text, size, POSIX_MADV_SEQUENTIAL);
+        ok = JSON_checker_parallel(jc, text + offset, size - offset, threads);
+    }
+    JSON_checker_set_error(jc, NULL);
+    if (!ok) {
+        JSON_error_locate(&error, text, size);
+        report(name, &error);
+    } else {
+        length = 8 + JSON_checker_save(jc, NULL, 0);
+        saved = (char*)malloc(length);
+        if (saved == NULL) {
+            fprintf(stderr, "JSON_checker: out of memory\n");
+            exit(1);
+        }
+        hash = fingerprint(text, size);
+        for (i = 0; i < 8; i += 1) {
+            saved[i] = (char)(hash >> (i * 8));
+        }
+        JSON_checker_save(jc, saved + 8, length - 8);
+        if (!write_checkpoint(path, saved, length)) {
+            fprintf(stderr, "JSON_checker: %s: %s\n", path, strerror(errno));
+            ok = 0;
+        }
+        free(saved);
+        printf("%s: %lu new bytes checked, %s\n", name,
+                (unsigned long)(size - offset),
+                JSON_checker_done(jc) ? "complete" : "not complete yet");
+    }
+    if (text != NULL) {
+        munmap(text, size);
+    }
+    free(path);
+    return ok;
+}
+
+
+int main(int argc, char* argv[]) {
+/*
+    Check STDIN, or each of the files named on the command line. Exit with a
+    message if any input is not well-formed JSON text.
+
+    jc will contain a JSON_checker with a maximum depth of 20, unless another
+    depth is given with -d.
+*/
+    struct JSON_checker_struct jc;
+    struct JSON_stats_struct probe;
+    int lines = 0;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int ok = 1;
+    int fd;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != 0; i += 1) {
+        if (strcmp(argv[i], "-l") == 0) {
+            lines = 1;
+        } else if (strcmp(argv[i], "-m") == 0) {
+            minified = 1;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            appended = 1;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            profiled = 1;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            i += 1;
+            threads = atoi(argv[i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            i += 1;
+            depth = atoi(argv[i]);
+        } else {
+            fprintf(stderr,
+                    "usage: JSON_checker [-l | -m | -c | -s] [-t threads] [-d depth] [file ...]\n");
+            exit(2);
+        }
+    }
+    if (lines + minified + appended + profiled > 1) {
+        fprintf(stderr,
+                "JSON_checker: -l, -m, -c, and -s can not be used together\n");
+        exit(2);
+    }
+    if (appended && i == argc) {
+        fprintf(stderr, "JSON_checker: -c needs files\n");
+        exit(2);
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (depth < 1) {
+        fprintf(stderr, "JSON_checker: the depth must be at least 1\n");
+        exit(2);
+    }
+    init_JSON_checker(&jc, depth);
+    if (profiled && !JSON_checker_set_stats(&jc, &probe)) {
+        fprintf(stderr, "JSON_checker: -s needs JSON_checker.c to be compiled "
+                "with JSON_CHECKER_STATS\n");
+        exit(2);
+    }
+    JSON_checker_set_stats(&jc, NULL);
+    if (i == argc) {
+        ok = lines
+            ? check_lines(0, "stdin", threads)
+            : check_text(&jc, 0, "stdin", threads);
+    }
+    for (; i < argc; i += 1) {
+        fd = (strcmp(argv[i], "-") == 0) ? 0 : open(argv[i], O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "JSON_checker: %s: %s\n", argv[i], strerror(errno));
+            ok = 0;
+            continue;
+        }
+        if (!(lines
+                ? check_lines(fd, argv[i], threads)
+                : appended
+                ? check_appended(&jc, fd, argv[i], threads)
+                : check_text(&jc, fd, argv[i], threads))) {
+            ok = 0;
+        }
+        if (fd != 0) {
+            close(fd);
+        }
+    }
+    JSON_checker_release(&jc);
+    exit(ok ? 0 : 1);
+}
@@ -1,6 +1,6 @@
 /* utf8_decode.c */
 
-/* 2016-04-05 */
+/* 2026-10-17 */
 
 /*
 Copyright (c) 2005 JSON.org
@@ -26,8 +26,15 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <stdint.h>
+#include <string.h>
 #include "utf8_decode.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UTF8_X86 1
+#include <immintrin.h>
+#endif
+
 /*
     Very Strict UTF-8 Decoder
 
@@ -52,23 +59,26 @@ SOFTWARE.
 */
 
 
-static int  the_index = 0;
-static int  the_length = 0;
-static int  the_char = 0;
-static int  the_byte = 0;
-static char* the_input;
+/*
+    The state of a decoding is kept in a utf8_decoder_struct, so any number of
+    decodings can proceed at once, in any number of threads. The older
+    functions without a decoder argument share the_decoder, and so are not
+    reentrant.
+*/
+
+static struct utf8_decoder_struct the_decoder;
 
 
 /*
     Get the next byte. It returns UTF8_END if there are no more bytes.
 */
-static int get() {
+static int get(utf8_decoder d) {
     int c;
-    if (the_index >= the_length) {
+    if (d->index >= d->length) {
         return UTF8_END;
     }
-    c = the_input[the_index] & 0xFF;
-    the_index += 1;
+    c = d->input[d->index] & 0xFF;
+    d->index += 1;
     return c;
 }
 
@@ -77,8 +87,8 @@ static int get() {
     Get the 6-bit payload of the next continuation byte.
     Return UTF8_ERROR if it is not a contination byte.
 */
-static int cont() {
-    int c = get();
+static int cont(utf8_decoder d) {
+    int c = get(d);
     return ((c & 0xC0) == 0x80)
         ? (c & 0x3F)
         : UTF8_ERROR;
@@ -86,22 +96,22 @@ static int cont() {
 
 
 /*
-    Initialize the UTF-8 decoder. The decoder is not reentrant,
+    Initialize a UTF-8 decoder.
 */
-void utf8_decode_init(char p[], int length) {
-    the_index = 0;
-    the_input = p;
-    the_length = length;
-    the_char = 0;
-    the_byte = 0;
+void utf8_decoder_init(utf8_decoder d, char p[], int length) {
+    d->index = 0;
+    d->input = p;
+    d->length = length;
+    d->character = 0;
+    d->byte = 0;
 }
 
 
 /*
     Get the current byte offset. This is generally used in error reporting.
 */
-int utf8_decode_at_byte() {
-    return the_byte;
+int utf8_decoder_at_byte(utf8_decoder d) {
+    return d->byte;
 }
 
 
@@ -109,9 +119,9 @@ int utf8_decode_at_byte() {
     Get the current character offset. This is generally used in error reporting.
     The character offset matches the byte offset if the text is strictly ASCII.
 */
-int utf8_decode_at_character() {
-    return (the_char > 0)
-        ? the_char - 1
+int utf8_decoder_at_character(utf8_decoder d) {
+    return (d->character > 0)
+        ? d->character - 1
         : 0;
 }
 
@@ -122,19 +132,19 @@ int utf8_decode_at_character() {
          or  UTF8_END   (the end)
          or  UTF8_ERROR (error)
 */
-int utf8_decode_next() {
+int utf8_decoder_next(utf8_decoder d) {
     int c;  /* the first byte of the character */
     int c1; /* the first continuation character */
     int c2; /* the second continuation character */
     int c3; /* the third continuation character */
     int r;  /* the result */
 
-    if (the_index >= the_length) {
-        return the_index == the_length ? UTF8_END : UTF8_ERROR;
+    if (d->index >= d->length) {
+        return d->index == d->length ? UTF8_END : UTF8_ERROR;
     }
-    the_byte = the_index;
-    the_char += 1;
-    c = get();
+    d->byte = d->index;
+    d->character += 1;
+    c = get(d);
 /*
     Zero continuation (0 to 127)
 */
@@ -145,7 +155,7 @@ int utf8_decode_next() {
     One continuation (128 to 2047)
 */
     if ((c & 0xE0) == 0xC0) {
-        c1 = cont();
+        c1 = cont(d);
         if (c1 >= 0) {
             r = ((c & 0x1F) << 6) | c1;
             if (r >= 128) {
@@ -157,8 +167,8 @@ int utf8_decode_next() {
     Two continuations (2048 to 55295 and 57344 to 65535)
 */
     } else if ((c & 0xF0) == 0xE0) {
-        c1 = cont();
-        c2 = cont();
+        c1 = cont(d);
+        c2 = cont(d);
         if ((c1 | c2) >= 0) {
             r = ((c & 0x0F) << 12) | (c1 << 6) | c2;
             if (r >= 2048 && (r < 55296 || r > 57343)) {
@@ -170,9 +180,9 @@ int utf8_decode_next() {
     Three continuations (65536 to 1114111)
 */
     } else if ((c & 0xF8) == 0xF0) {
-        c1 = cont();
-        c2 = cont();
-        c3 = cont();
+        c1 = cont(d);
+        c2 = cont(d);
+        c3 = cont(d);
         if ((c1 | c2 | c3) >= 0) {
             r = ((c & 0x07) << 18) | (c1 << 12) | (c2 << 6) | c3;
             if (r >= 65536 && r <= 1114111) {
@@ -182,3 +192,264 @@ int utf8_decode_next() {
     }
     return UTF8_ERROR;
 }
+
+
+/*
+    The original interface, using the_decoder.
+*/
+void utf8_decode_init(char p[], int length) {
+    utf8_decoder_init(&the_decoder, p, length);
+}
+
+
+int utf8_decode_at_byte() {
+    return utf8_decoder_at_byte(&the_decoder);
+}
+
+
+int utf8_decode_at_character() {
+    return utf8_decoder_at_character(&the_decoder);
+}
+
+
+int utf8_decode_next() {
+    return utf8_decoder_next(&the_decoder);
+}
+
+
+/*
+    Bulk validation
+
+    utf8_validate checks a whole buffer against the same rules as
+    utf8_decode_next without decoding it. It returns length if the buffer is
+    good, or else the byte offset of the character that utf8_decode_next would
+    have rejected.
+*/
+
+static size_t utf8_validate_scalar(
+    const unsigned char p[],
+    size_t index,
+    size_t length
+) {
+    int c;      /* the first byte of the character */
+    int count;  /* the number of continuation bytes */
+    int low;    /* the smallest allowed first continuation byte */
+    int high;   /* the largest allowed first continuation byte */
+    int k;
+    uint64_t eight;
+
+    while (index < length) {
+
+/*
+    Skip ASCII eight bytes at a time.
+*/
+        if (length - index >= 8) {
+            memcpy(&eight, &p[index], 8);
+            if ((eight & 0x8080808080808080ULL) == 0) {
+                index += 8;
+                continue;
+            }
+        }
+        c = p[index];
+        if (c < 0x80) {
+            index += 1;
+            continue;
+        }
+        low = 0x80;
+        high = 0xBF;
+        if (c < 0xC2) {
+            return index;
+        } else if (c < 0xE0) {
+            count = 1;
+        } else if (c < 0xF0) {
+            count = 2;
+            if (c == 0xE0) {
+                low = 0xA0;     /* overlong */
+            } else if (c == 0xED) {
+                high = 0x9F;    /* surrogate */
+            }
+        } else if (c < 0xF5) {
+            count = 3;
+            if (c == 0xF0) {
+                low = 0x90;     /* overlong */
+            } else if (c == 0xF4) {
+                high = 0x8F;    /* above 1114111 */
+            }
+        } else {
+            return index;
+        }
+        if (length - index <= (size_t)count ||
+                p[index + 1] < low || p[index + 1] > high) {
+            return index;
+        }
+        for (k = 2; k <= count; k += 1) {
+            if ((p[index + k] & 0xC0) != 0x80) {
+                return index;
+            }
+        }
+        index += count + 1;
+    }
+    return length;
+}
+
+
+#if defined(UTF8_X86)
+
+/*
+    The SSSE3 validator checks 16 bytes at a time with the lookup method of
+    Keiser and Lemire. Three table lookups, on the high and low nibbles of
+    each byte's predecessor and the high nibble of the byte itself, classify
+    every pair of adjacent bytes. The bitwise and of the three lookups is
+    nonzero where the pair is an error. The third and fourth bytes of
+    3- and 4-byte sequences are checked separately with a saturating
+    subtract.
+
+    When a block contains an error, or fewer than 16 bytes remain, the scalar
+    validator takes over at the start of the character that straddles the
+    block boundary. That way the offset it reports is exact.
+*/
+
+#define TOO_SHORT   (1 << 0)    /* 11______ 0_______ or 11______ 11______ */
+#define TOO_LONG    (1 << 1)    /* 0_______ 10______ */
+#define OVERLONG_3  (1 << 2)    /* 11100000 100_____ */
+#define TOO_LARGE   (1 << 3)    /* 11110100 1001____ and beyond */
+#define SURROGATE   (1 << 4)    /* 11101101 101_____ */
+#define OVERLONG_2  (1 << 5)    /* 1100000_ 10______ */
+#define TOO_LARGE_1000 (1 << 6) /* 11110101 1000____ and beyond */
+#define OVERLONG_4  (1 << 6)    /* 11110000 1000____ */
+#define TWO_CONTS   (1 << 7)    /* 10______ 10______ */
+#define CARRY       (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+__attribute__((target("ssse3")))
+static size_t utf8_validate_ssse3(const unsigned char p[], size_t length) {
+    const __m128i byte_1_high = _mm_setr_epi8(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+    );
+    const __m128i byte_1_low = _mm_setr_epi8(
+        (char)(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4),
+        (char)(CARRY | OVERLONG_2),
+        (char)CARRY,
+        (char)CARRY,
+        (char)(CARRY | TOO_LARGE),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000)
+    );
+    const __m128i byte_2_high = _mm_setr_epi8(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+    );
+/*
+    A block ends with an incomplete character if its last byte is a lead byte,
+    its second to last begins a 3- or 4-byte sequence, or its third to last
+    begins a 4-byte sequence.
+*/
+    const __m128i incomplete = _mm_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1)
+    );
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i prev = zero;
+    __m128i prev_incomplete = zero;
+    __m128i input, prev1, prev2, prev3, special, must23, error;
+    size_t index = 0;
+    size_t start;
+    int k;
+
+    while (length - index >= 16) {
+        input = _mm_loadu_si128((const __m128i*)&p[index]);
+        if (_mm_movemask_epi8(input) == 0) {
+            error = prev_incomplete;
+        } else {
+            prev1 = _mm_alignr_epi8(input, prev, 15);
+            special = _mm_and_si128(
+                _mm_and_si128(
+                    _mm_shuffle_epi8(byte_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                    _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, nibble))
+                ),
+                _mm_shuffle_epi8(byte_2_high, _mm_and_si128(_mm_srli_epi16(input, 4), nibble))
+            );
+            prev2 = _mm_alignr_epi8(input, prev, 14);
+            prev3 = _mm_alignr_epi8(input, prev, 13);
+            must23 = _mm_and_si128(
+                _mm_or_si128(
+                    _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80)),
+                    _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)))
+                ),
+                _mm_set1_epi8((char)0x80)
+            );
+            error = _mm_xor_si128(must23, special);
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) != 0xFFFF) {
+            break;
+        }
+        prev_incomplete = _mm_subs_epu8(input, incomplete);
+        prev = input;
+        index += 16;
+    }
+
+/*
+    Back up to the start of a character that might straddle index.
+*/
+    start = index;
+    for (k = 1; k <= 3 && k <= (int)index; k += 1) {
+        if ((p[index - k] & 0xC0) != 0x80) {
+            start = index - k;
+            break;
+        }
+    }
+    return utf8_validate_scalar(p, start, length);
+}
+
+#endif
+
+
+static size_t utf8_validate_portable(const unsigned char p[], size_t length) {
+    return utf8_validate_scalar(p, 0, length);
+}
+
+
+static size_t (*the_validator)(const unsigned char p[], size_t length) =
+    utf8_validate_portable;
+
+
+#if defined(UTF8_X86)
+
+__attribute__((constructor))
+static void select_validator(void) {
+/*
+    Choose the validator while the program is loaded, before any thread can
+    call utf8_validate, so the_validator is never written while it is read.
+*/
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        the_validator = utf8_validate_ssse3;
+    }
+}
+
+#endif
+
+
+size_t utf8_validate(const char p[], size_t length) {
+    return the_validator((const unsigned char*)p, length);
+}
@@ -1,9 +1,34 @@
 /* utf8_decode.h */
 
+#include <stddef.h>
+
 #define UTF8_END   -1
 #define UTF8_ERROR -2
 
+/*
+    The utf8_decoder_struct holds the state of one decoding, so that the
+    utf8_decoder functions are reentrant.
+*/
+
+typedef struct utf8_decoder_struct {
+    int index;
+    int length;
+    int character;
+    int byte;
+    char* input;
+} * utf8_decoder;
+
+extern int  utf8_decoder_at_byte(utf8_decoder d);
+extern int  utf8_decoder_at_character(utf8_decoder d);
+extern void utf8_decoder_init(utf8_decoder d, char p[], int length);
+extern int  utf8_decoder_next(utf8_decoder d);
+
+/*
+    The original functions share a single decoder, so they are not reentrant.
+*/
+
 extern int  utf8_decode_at_byte();
 extern int  utf8_decode_at_character();
 extern void utf8_decode_init(char p[], int length);
 extern int  utf8_decode_next();
+extern size_t utf8_validate(const char p[], size_t length);
@@ -1,6 +1,6 @@
 /* utf8_to_utf16.c */
 
-/* 2016-04-05 */
+/* 2026-10-17 */
 
 /*
 Copyright (c) 2005 JSON.org
@@ -29,28 +29,137 @@ SOFTWARE.
 #include "utf8_to_utf16.h"
 #include "utf8_decode.h"
 
-static int the_index;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-int utf8_to_utf16(unsigned short w[], char p[], int length) {
+/*
+    These functions keep all of their state in local variables, so they are
+    reentrant.
+*/
+
+int utf8_to_utf16_length(char p[], int length) {
+/*
+    Return the exact number of UTF-16 code units that utf8_to_utf16 will
+    produce for the text, or UTF8_ERROR if the text is not strict UTF-8.
+
+    Every character contributes one unit, except that characters above 65535
+    contribute two. So the answer is the number of bytes that are not
+    continuation bytes, plus the number of bytes that begin 4-byte sequences.
+*/
+    const unsigned char* u = (const unsigned char*)p;
+    int count = length;
+    int index = 0;
+
+    if (length < 0 || utf8_validate(p, (size_t)length) != (size_t)length) {
+        return UTF8_ERROR;
+    }
+#if defined(__SSE2__)
+    {
+        const __m128i below_lead = _mm_set1_epi8((char)0xC0);
+        const __m128i four = _mm_set1_epi8((char)0xF0);
+        const __m128i bias = _mm_set1_epi8((char)0x80);
+        while (length - index >= 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)&u[index]);
+            if (_mm_movemask_epi8(x) != 0) {
+                count -= __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi8(
+                    _mm_xor_si128(x, bias),
+                    _mm_xor_si128(below_lead, bias)
+                )) & _mm_movemask_epi8(x));
+                count += __builtin_popcount(_mm_movemask_epi8(
+                    _mm_cmpeq_epi8(_mm_max_epu8(x, four), x)
+                ));
+            }
+            index += 16;
+        }
+    }
+#endif
+    while (index < length) {
+        if ((u[index] & 0xC0) == 0x80) {
+            count -= 1;
+        } else if (u[index] >= 0xF0) {
+            count += 1;
+        }
+        index += 1;
+    }
+    return count;
+}
+
+
+int utf8_to_utf16_bounded(
+    unsigned short w[],
+    int capacity,
+    char p[],
+    int length
+) {
+/*
+    Convert the UTF-8 text in p to UTF-16 in w, writing at most capacity code
+    units. Return the number of code units, or UTF8_ERROR if the text is not
+    strict UTF-8, or UTF16_OVERFLOW if w is too small.
+
+    The text is first checked with utf8_validate, so the conversion itself
+    does not need to check anything. Runs of ASCII are widened 16 bytes at a
+    time. Multibyte sequences are assembled directly.
+*/
+    const unsigned char* u = (const unsigned char*)p;
+    int at = 0;
+    int index = 0;
     int c;
-    utf8_decode_init(p, length);
-    the_index = 0;
-    for (;;) {
-        c = utf8_decode_next();
-        if (c < 0) {
-            return (c == UTF8_END)
-                ? the_index
-                : UTF8_ERROR;
+
+    if (length < 0 || utf8_validate(p, (size_t)length) != (size_t)length) {
+        return UTF8_ERROR;
+    }
+    while (at < length) {
+#if defined(__SSE2__)
+        while (length - at >= 16 && capacity - index >= 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)&u[at]);
+            if (_mm_movemask_epi8(x) != 0) {
+                break;
+            }
+            _mm_storeu_si128((__m128i*)&w[index], _mm_unpacklo_epi8(x, _mm_setzero_si128()));
+            _mm_storeu_si128((__m128i*)&w[index + 8], _mm_unpackhi_epi8(x, _mm_setzero_si128()));
+            at += 16;
+            index += 16;
+        }
+        if (at >= length) {
+            break;
         }
-        if (c < 0x10000) {
-            w[the_index] = (unsigned short)c;
-            the_index += 1;
+#endif
+        if (index >= capacity) {
+            return UTF16_OVERFLOW;
+        }
+        c = u[at];
+        if (c < 0x80) {
+            w[index] = (unsigned short)c;
+            at += 1;
+        } else if (c < 0xE0) {
+            w[index] = (unsigned short)(((c & 0x1F) << 6) | (u[at + 1] & 0x3F));
+            at += 2;
+        } else if (c < 0xF0) {
+            w[index] = (unsigned short)(((c & 0x0F) << 12) |
+                    ((u[at + 1] & 0x3F) << 6) | (u[at + 2] & 0x3F));
+            at += 3;
         } else {
-            c -= 0x10000;
-            w[the_index] = (unsigned short)(0xD800 | (c >> 10));
-            the_index += 1;
-            w[the_index] = (unsigned short)(0xDC00 | (c & 0x3FF));
-            the_index += 1;
+            if (index + 1 >= capacity) {
+                return UTF16_OVERFLOW;
+            }
+            c = (((c & 0x07) << 18) | ((u[at + 1] & 0x3F) << 12) |
+                    ((u[at + 2] & 0x3F) << 6) | (u[at + 3] & 0x3F)) - 0x10000;
+            w[index] = (unsigned short)(0xD800 | (c >> 10));
+            index += 1;
+            w[index] = (unsigned short)(0xDC00 | (c & 0x3FF));
+            at += 4;
         }
+        index += 1;
     }
+    return index;
+}
+
+
+int utf8_to_utf16(unsigned short w[], char p[], int length) {
+/*
+    The original interface. w must have room for at least as many code units
+    as there are bytes in p, which is always enough.
+*/
+    return utf8_to_utf16_bounded(w, length, p, length);
 }
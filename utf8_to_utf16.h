@@ -1,3 +1,12 @@
 /* utf8_to_utf16.h */
 
+#define UTF16_OVERFLOW -3
+
 extern int utf8_to_utf16(unsigned short w[], char p[], int length);
+extern int utf8_to_utf16_bounded(
+    unsigned short w[],
+    int capacity,
+    char p[],
+    int length
+);
+extern int utf8_to_utf16_length(char p[], int length);